@@ -2,121 +2,172 @@
 #include <stdlib.h>
 #include <sys/time.h>
 #include <time.h>
+#include <unistd.h>
 
+#include "tt_anim.h"
+#include "tt_perf.h"
+#include "tt_replay.h"
+#include "tt_rewind.h"
+#include "tt_stream.h"
+#include "tt_term.h"
 #include "tt_tetris.h"
+#include "tt_ui.h"
 
-cursor_main_menu main_menu(tt_tetris *tetris, cursor_main_menu menuitem);
-
-void game_menu(tt_tetris *tetris);
-
-void game_input(tt_tetris *tetris, int key);
+/**
+ * Reads the wall clock.
+ * @return the current time in microseconds.
+ */
+static long long now() {
+	struct timeval current;
+	gettimeofday(&current, NULL);
+	return current.tv_sec * 1000000LL + current.tv_usec;
+}
 
-int main(void) {
+int main(int argc, char *argv[]) {
 	srand((unsigned int)time(NULL));
 
-	tt_tetris *tetris = tt_init_tetris();
-
-	cursor_main_menu cursor = NEW_GAME;
-	while (cursor != QUIT) {
-		switch (cursor = main_menu(tetris, cursor)) {
-		case NEW_GAME: game_menu(tetris); break;
-		case HIGH_SCORE: dw_show_static_window(tetris->w_highscore, tetris->w_main); break;
-		case HELP_MENU: dw_show_static_window(tetris->w_help, tetris->w_main); break;
-		default: break;
+	// "--host PATH" waits for an opponent on a local socket, "--join PATH" connects to one,
+	// "--broadcast PATH" shares the game with spectators, "--stream PATH" records it to a file,
+	// "--perf PATH" enables the instrumentation and dumps its statistics to a file at exit,
+	// "--low-bandwidth" draws the game with minimal escape sequences, "--half-blocks" also packs
+	// two board rows into every terminal row, "--board COLSxROWS" changes the size of the board,
+	// "--practice" lets the player take back pieces, "--bot" lets the bot play the single games,
+	// "--cache PATH" maps a placement cache written by ttcache for the bot, "--record PATH" appends
+	// the single games to an archive for ttstats, "--players N" lets 2 to 4 players share the
+	// keyboard in a versus match
+	const char *host = NULL, *join = NULL, *ring = NULL, *file = NULL, *stats = NULL, *placements = NULL,
+	           *archive = NULL;
+	bool lean = false, half_blocks = false, undo = false, autoplay = false;
+	int rows = BOARD_Y, cols = BOARD_X, players = 2;
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--low-bandwidth")) lean = true;
+		else if (!strcmp(argv[i], "--half-blocks")) lean = half_blocks = true;
+		else if (!strcmp(argv[i], "--practice")) undo = true;
+		else if (!strcmp(argv[i], "--bot")) autoplay = true;
+		else if (i + 1 == argc) break;
+		else if (!strcmp(argv[i], "--host")) host = argv[++i];
+		else if (!strcmp(argv[i], "--join")) join = argv[++i];
+		else if (!strcmp(argv[i], "--broadcast")) ring = argv[++i];
+		else if (!strcmp(argv[i], "--stream")) file = argv[++i];
+		else if (!strcmp(argv[i], "--perf")) stats = argv[++i];
+		else if (!strcmp(argv[i], "--cache")) placements = argv[++i];
+		else if (!strcmp(argv[i], "--record")) archive = argv[++i];
+		else if (!strcmp(argv[i], "--players")) players = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--board") && sscanf(argv[++i], "%dx%d", &cols, &rows) != 2) {
+			fprintf(stderr, "Board size has to be given as COLSxROWS!\n");
+			return EXIT_FAILURE;
 		}
 	}
-	tt_destroy_tetris(tetris);
-	return EXIT_SUCCESS;
-}
+	if (players < 2 || players > VS_MAX_PLAYERS) {
+		fprintf(stderr, "A versus match takes 2 to %d players!\n", VS_MAX_PLAYERS);
+		return EXIT_FAILURE;
+	}
 
-long elapsed_time(struct timeval start, struct timeval current) {
-	return ((current.tv_sec - start.tv_sec) * 1000000) + (current.tv_usec - start.tv_usec);
-}
+	// taking back pieces cannot be replayed from the inputs
+	if (archive && undo) {
+		fprintf(stderr, "Practice games can't be recorded!\n");
+		return EXIT_FAILURE;
+	}
+	rp_recorder recorder;
+	if (archive && !rp_open(&recorder, archive)) {
+		fprintf(stderr, "Couldn't open game archive %s!\n", archive);
+		return EXIT_FAILURE;
+	}
 
-/**
- * Function for navigating through the different menu options.
- * It loops till a menu item has been selected.
- * @param tetris
- * @param menuitem describes the currently selected menu item.
- * @return the selected menu item if enter has been pressed.
- */
-cursor_main_menu main_menu(tt_tetris *tetris, cursor_main_menu menuitem) {
-	int key;
-	dw_draw_main_menu(tetris, menuitem);
+	st_stream stream;
+	if ((ring || file) && !st_open(&stream, ring, file)) {
+		fprintf(stderr, "Couldn't open spectator stream!\n");
+		return EXIT_FAILURE;
+	}
 
-	while (true) {
-		key = getch();
-		switch (key) {
-		case KEY_DOWN: menuitem = (menuitem + 1) % NUM_MAIN_MENU; break;
-		case KEY_UP: menuitem = (menuitem - 1) % NUM_MAIN_MENU; break;
-		case 'h':
-			dw_show_static_window(tetris->w_help, tetris->w_main);
-			break;
-			return HELP_MENU;
-		case '\n': return menuitem;
-		case 'q': return QUIT;
-		default: break;
-		}
-		dw_draw_main_menu(tetris, menuitem);
+	pf_stats perf;
+	if (stats) {
+		pf_init(&perf, stats);
 	}
-}
 
-/**
- * Starts the game and loops till the game is over or quit has been pressed.
- * It calls the following external functions at the start:
- *  - gm_reset_game
- *  - dw_draw_game_window
- * It calls the following functions in a loop:
- *  - dw_is_game_over
- *  - game_input
- *  - dw_draw_game_window
- * It calls the following functions once at the end:
- *  - dw_draw_game_over
- *  - dw_show_static_window
- *  - game_menu
- * @param tetris
- */
-void game_menu(tt_tetris *tetris) {
-	gm_reset_game(tetris);
-	dw_draw_game_window(tetris);
+	tt_tetris *tetris = tt_init_tetris(stats ? &perf : NULL, rows, cols);
+	if (!tetris) {
+		if (archive) rp_close(&recorder, NULL);
+		if (ring || file) st_close(&stream);
+		if (stats) pf_close(&perf);
+		return EXIT_FAILURE;
+	}
+	if (ring || file) {
+		tetris->broadcast = &stream;
+	}
 
-	struct timeval start, current;
-	gettimeofday(&start, NULL);
-	while (!gm_is_game_over(tetris)) {
-		int key = getch();
-		if (key != ERR) {
-			game_input(tetris, key);
+	// with the instrumentation enabled the output has to pass the relay, to be counted and to
+	// stay in order with what curses writes
+	tm_terminal terminal, *low_bandwidth = NULL;
+	if (lean) {
+		int fd = stats && perf.terminal ? fileno(perf.terminal) : fileno(stdout);
+		int size_y, size_x;
+		dw_game_size(rows, cols, &size_y, &size_x);
+		if (tm_init(&terminal, fd, size_y + 2, size_x + 2, half_blocks)) {
+			low_bandwidth = &terminal;
+			tetris->renderer = &terminal.frame.base;
 		}
-		if (key == 'q') {
-			return;
-		}
-		gettimeofday(&current, NULL);
-		if (elapsed_time(start, current) > tetris->speed) {
-			game_input(tetris, KEY_DOWN);
-			gettimeofday(&start, NULL);
-		}
-		dw_draw_game_window(tetris);
 	}
-	dw_draw_game_over(tetris);
-	dw_show_static_window(tetris->w_game_over, tetris->w_highscore);
-	game_menu(tetris);
-}
 
-/**
- * Function that maps a pressed key to the correct block movement.
- * @param tetris
- * @param key that has been pressed.
- */
-void game_input(tt_tetris *tetris, int key) {
-	// if (tetris->is_over) {}
-	switch (key) {
-	case 'h': dw_show_static_window(tetris->w_help, tetris->w_game);
-	case KEY_LEFT: gm_move_block(tetris, TT_LEFT); break;
-	case KEY_RIGHT: gm_move_block(tetris, TT_RIGHT); break;
-	case KEY_DOWN: gm_move_block(tetris, TT_DOWN); break;
-	case ' ': gm_move_block(tetris, TT_FALL_DOWN); break;
-	case KEY_UP: gm_move_block(tetris, TT_ROTATE); break;
-	case 's': gm_move_block(tetris, TT_ALTER_TIME); break;
-	default: break;
+	an_timeline timeline = { 0 };
+	tetris->animation = &timeline;
+
+	rw_history history, *practice = NULL;
+	if (undo) {
+		if (rw_init(&history, RW_PIECES, rows, cols)) practice = &history;
+		else rw_destroy(&history);
 	}
+
+	bt_searcher searcher, *bot = NULL;
+	if (autoplay) {
+		if (bt_init_searcher(&searcher, (int)sysconf(_SC_NPROCESSORS_ONLN))) bot = &searcher;
+		else bt_destroy_searcher(&searcher);
+	}
+	pc_cache lookup, *cache = NULL;
+	if (placements && pc_open(&lookup, placements)) {
+		cache = &lookup;
+	}
+
+	// every screen handles a key and returns, getch waits for at most TIME_DELAY milliseconds
+	ui_session session;
+	ui_init(&session, tetris, low_bandwidth, practice, bot, cache, archive ? &recorder : NULL, players, now());
+	if (host || join) {
+		ui_start_versus(&session, host, join);
+	}
+	int key;
+	do {
+		key = getch();
+	} while (ui_step(&session, key, now()));
+	if (archive) {
+		rp_close(&recorder, tetris);
+	}
+	tt_destroy_tetris(tetris);
+	if (low_bandwidth) {
+		fprintf(stderr, "low-bandwidth output: %llu frames, %llu bytes, %.1f bytes/frame\n",
+		        terminal.frames, terminal.bytes, terminal.frames ? (double)terminal.bytes / terminal.frames : 0.0);
+		tm_destroy(&terminal);
+	}
+	if (practice) {
+		rw_destroy(practice);
+	}
+	if (bot) {
+		bt_destroy_searcher(bot);
+	}
+	if (cache) {
+		fprintf(stderr, "placement cache: %llu hits, %llu misses\n", cache->hits, cache->misses);
+		pc_close(cache);
+	} else if (placements) {
+		fprintf(stderr, "No placement cache found at %s!\n", placements);
+	}
+	if (archive) {
+		fprintf(stderr, "recorded %llu games to %s\n", recorder.games, archive);
+	}
+	if (ring || file) {
+		st_close(&stream);
+	}
+	if (stats) {
+		pf_close(&perf);
+		if (!pf_dump(&perf)) fprintf(stderr, "Couldn't write statistics to %s!\n", stats);
+	}
+	return EXIT_SUCCESS;
 }
@@ -0,0 +1,135 @@
+#include "tt_anim.h"
+
+/** Time a flashing row stays shown or hidden in microseconds. */
+#define BLINK_US 50000
+
+/**
+ * Drops all effects and starts following the game from its current state, e.g. a new game.
+ * @param timeline
+ * @param tetris
+ */
+void an_restart(an_timeline *timeline, const tt_tetris *tetris) {
+	timeline->count = 0;
+	timeline->block_count = tetris->block_count;
+	timeline->score = tetris->score;
+}
+
+/**
+ * Adds an effect. If all slots are taken the oldest effect makes room.
+ * @param timeline
+ * @param effect
+ */
+static void schedule(an_timeline *timeline, an_effect effect) {
+	if (timeline->count == AN_EFFECTS) {
+		memmove(&timeline->effects[0], &timeline->effects[1], sizeof(an_effect) * (AN_EFFECTS - 1));
+		--timeline->count;
+	}
+	timeline->effects[timeline->count++] = effect;
+}
+
+/**
+ * Drops the effects that ended before the given time or, if rows is true, any flash or collapse.
+ * @param timeline
+ * @param now
+ * @param rows
+ */
+static void drop_effects(an_timeline *timeline, long long now, bool rows) {
+	int kept = 0;
+	for (int i = 0; i < timeline->count; i++) {
+		an_effect *effect = &timeline->effects[i];
+		if (now < effect->start + effect->duration && !(rows && effect->kind != AN_SCORE_POP)) {
+			timeline->effects[kept++] = *effect;
+		}
+	}
+	timeline->count = kept;
+}
+
+/**
+ * Moves the timeline to the time of the next frame. Effects that ended are dropped, a line clear
+ * since the previous call schedules a flash, the collapse right after it and a score pop.
+ * A new clear moves the rows a running collapse refers to, so it replaces flash and collapse.
+ * @param timeline
+ * @param tetris
+ * @param now frame time in microseconds.
+ */
+void an_advance(an_timeline *timeline, const tt_tetris *tetris, long long now) {
+	timeline->now = now;
+	drop_effects(timeline, now, false);
+	if (tetris->block_count == timeline->block_count) {
+		return;
+	}
+	if (tetris->block_count != timeline->block_count + 1) {
+		an_restart(timeline, tetris);
+		return;
+	}
+	unsigned points = tetris->score - timeline->score;
+	timeline->block_count = tetris->block_count;
+	timeline->score = tetris->score;
+	if (!tetris->last_cleared) {
+		return;
+	}
+	drop_effects(timeline, now, true);
+	int first = tetris->last_locked.y;
+	unsigned rows = tetris->last_cleared;
+	schedule(timeline, (an_effect){ AN_FLASH, now, AN_FLASH_US, first, rows, points });
+	schedule(timeline, (an_effect){ AN_COLLAPSE, now + AN_FLASH_US, AN_COLLAPSE_US, first, rows, points });
+	schedule(timeline, (an_effect){ AN_SCORE_POP, now, AN_SCORE_POP_US, first, rows, points });
+}
+
+/**
+ * Looks up the running effect of a kind.
+ * @param timeline
+ * @param kind AN_FLASH or AN_COLLAPSE, of which there is one at most.
+ * @return the effect or NULL.
+ */
+static const an_effect *find_effect(const an_timeline *timeline, an_kind kind) {
+	for (int i = 0; i < timeline->count; i++) {
+		if (timeline->effects[i].kind == kind) {
+			return &timeline->effects[i];
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Returns how many rows higher than its place on the board a row is drawn right now, while the
+ * rows above a clear slide down. Until the collapse starts the rows keep the place they had
+ * before the clear, which is one row higher for every cleared row below. The rows are walked from
+ * the bottom, every cleared row at or below the place a row came from lifts it by one.
+ * @param timeline
+ * @param y row of the board.
+ * @return
+ */
+int an_row_lift(const an_timeline *timeline, int y) {
+	const an_effect *collapse = find_effect(timeline, AN_COLLAPSE);
+	if (!collapse) {
+		return 0;
+	}
+	int lift = 0;
+	for (int i = 3; i >= 0; i--) {
+		if ((collapse->rows >> i & 1) && collapse->first + i >= y - lift) {
+			++lift;
+		}
+	}
+	long long elapsed = timeline->now - collapse->start;
+	if (elapsed <= 0) {
+		return lift;
+	}
+	return (int)((lift * (collapse->duration - elapsed) + collapse->duration / 2) / collapse->duration);
+}
+
+/**
+ * Returns true if a row that has been cleared is shown flashing right now, at the place it had
+ * in the board before the clear.
+ * @param timeline
+ * @param y row of the board before the clear.
+ * @return
+ */
+bool an_row_flashes(const an_timeline *timeline, int y) {
+	const an_effect *flash = find_effect(timeline, AN_FLASH);
+	if (!flash || y < flash->first || y >= flash->first + 4 || !(flash->rows >> (y - flash->first) & 1)) {
+		return false;
+	}
+	long long elapsed = timeline->now - flash->start;
+	return elapsed >= 0 && elapsed / BLINK_US % 2 == 0;
+}
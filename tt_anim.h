@@ -0,0 +1,89 @@
+#ifndef TT_ANIM_H
+#define TT_ANIM_H
+
+#include "tt_types.h"
+
+/** Number of effects that can run at the same time. */
+#define AN_EFFECTS 8
+
+/** Duration of the flash of cleared rows in microseconds. */
+#define AN_FLASH_US 150000
+
+/** Duration of the rows above sliding down into the cleared rows in microseconds. */
+#define AN_COLLAPSE_US 150000
+
+/** Duration of the points of a clear floating above the board in microseconds. */
+#define AN_SCORE_POP_US 700000
+
+/** Color pair the cleared rows flash in. */
+#define AN_FLASH_COLOR 7
+
+/**
+ * Kinds of effects:
+ *  - AN_FLASH: the cleared rows blink at the place they were cleared from
+ *  - AN_COLLAPSE: the rows above slide down into the gap, the board already has them there
+ *  - AN_SCORE_POP: the points of the clear float up next to the board
+ */
+typedef enum { AN_FLASH, AN_COLLAPSE, AN_SCORE_POP } an_kind;
+
+/**
+ * A timed effect. Cleared rows are given like last_cleared: bit i stands for row first + i of the
+ * board before the clear.
+ */
+typedef struct {
+	an_kind kind;
+	long long start, duration;
+	int first;
+	unsigned rows;
+	unsigned points;
+} an_effect;
+
+/**
+ * Schedules effects for the line clears of a game and tells the renderer how to overlay them.
+ * The game never waits for an effect, it has cleared the rows already; the timeline only changes
+ * where the renderer draws the rows above a clear and what it draws on top, for the frame time
+ * given last to an_advance.
+ */
+typedef struct an_timeline {
+	an_effect effects[AN_EFFECTS];
+	int count;
+	long long now;
+	unsigned block_count;
+	unsigned score;
+} an_timeline;
+
+/**
+ * Drops all effects and starts following the game from its current state, e.g. a new game.
+ * @param timeline
+ * @param tetris
+ */
+void an_restart(an_timeline *timeline, const tt_tetris *tetris);
+
+/**
+ * Moves the timeline to the time of the next frame. Effects that ended are dropped, a line clear
+ * since the previous call schedules new ones.
+ * @param timeline
+ * @param tetris
+ * @param now frame time in microseconds.
+ */
+void an_advance(an_timeline *timeline, const tt_tetris *tetris, long long now);
+
+/**
+ * Returns how many rows higher than its place on the board a row is drawn right now, while the
+ * rows above a clear slide down.
+ * @param timeline
+ * @param y row of the board.
+ * @return
+ */
+int an_row_lift(const an_timeline *timeline, int y);
+
+/**
+ * Returns true if a row that has been cleared is shown flashing right now, at the place it had
+ * in the board before the clear.
+ * @param timeline
+ * @param y row of the board before the clear.
+ * @return
+ */
+bool an_row_flashes(const an_timeline *timeline, int y);
+
+#endif // TT_ANIM_H
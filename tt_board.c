@@ -0,0 +1,289 @@
+#include "tt_board.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define BD_AVX2
+#endif
+
+/**
+ * Returns the tiles of a block row as bits, bit j standing for column j of the block.
+ * Blocks are at most four tiles wide and the unused part of their array is zero.
+ * @param block
+ * @param row
+ * @return
+ */
+static uint64_t block_row(const tetris_block *block, int row) {
+	const char *tiles = block->array[row];
+	return (tiles[0] != 0) | (tiles[1] != 0) << 1 | (tiles[2] != 0) << 2 | (tiles[3] != 0) << 3;
+}
+
+/**
+ * Moves the bits of a block row to column x of the board.
+ * @param bits tiles of the block row, at most five bits wide.
+ * @param x column of the block, may be negative.
+ * @param cols width of the board.
+ * @param placed receives the bits in board columns.
+ * @return false if any tile would be left or right of the board.
+ */
+static bool place_row(uint64_t bits, int x, int cols, uint64_t *placed) {
+	if (x < 0) {
+		if (x <= -8 || bits & ((1ull << -x) - 1)) return false;
+		*placed = bits >> -x;
+		return true;
+	}
+	if (x >= cols || (cols - x < 8 && bits >> (cols - x))) return false;
+	*placed = bits << x;
+	return true;
+}
+
+/**
+ * Returns the word of a row with all pixels of a board occupied.
+ * @param cols
+ * @return
+ */
+static uint64_t full_row(int cols) {
+	return cols >= 64 ? ~0ull : (1ull << cols) - 1;
+}
+
+/**
+ * Defines the kernels for one width class. Rows are words of the given type, which is exactly
+ * as wide as the class, so a board of 16 columns only touches two bytes per row.
+ */
+#define BOARD_KERNELS(bits, word)                                                                \
+static bool collides_##bits(const tt_tetris *tetris, const tetris_block *block,                \
+                            int x_move, int y_move) {                                          \
+	const word *rows = tetris->row_bits.w##bits;                                                \
+	int x = block->x + x_move, y = block->y + y_move;                                           \
+	for (int i = 0; i < block->width; i++) {                                                    \
+		uint64_t tiles = block_row(block, i), placed;                                           \
+		if (!tiles) continue;                                                                   \
+		if (y + i < 0 || y + i >= tetris->rows) return true;                                    \
+		if (!place_row(tiles, x, tetris->cols, &placed)) return true;                           \
+		if (rows[y + i] & (word)placed) return true;                                            \
+	}                                                                                           \
+	return false;                                                                               \
+}                                                                                               \
+                                                                                                \
+static void place_##bits(tt_tetris *tetris, const tetris_block *block) {                        \
+	word *rows = tetris->row_bits.w##bits;                                                      \
+	for (int i = 0; i < block->width; i++) {                                                    \
+		int y = block->y + i;                                                                   \
+		uint64_t placed;                                                                        \
+		if (y < 0 || y >= tetris->rows) continue;                                               \
+		if (!place_row(block_row(block, i), block->x, tetris->cols, &placed)) continue;         \
+		rows[y] |= (word)placed;                                                                \
+		for (int j = 0; j < block->width; j++) {                                                \
+			if (block->array[i][j]) tetris->board[y][block->x + j] = block->color;              \
+		}                                                                                       \
+	}                                                                                           \
+}                                                                                               \
+                                                                                                \
+static unsigned clear_rows_##bits(tt_tetris *tetris, int first, int count) {                    \
+	word *rows = tetris->row_bits.w##bits;                                                      \
+	word full = (word)full_row(tetris->cols);                                                   \
+	unsigned cleared = 0;                                                                       \
+	for (int i = 0; i < count; i++) {                                                           \
+		int row = first + i;                                                                    \
+		if (row < 0 || row >= tetris->rows || rows[row] != full) continue;                      \
+		memmove(&rows[1], &rows[0], sizeof(*rows) * row);                                       \
+		memmove(tetris->board[1], tetris->board[0], sizeof(tetris->board[0]) * row);            \
+		rows[0] = 0;                                                                            \
+		memset(tetris->board[0], 0, sizeof(tetris->board[0]));                                  \
+		cleared |= 1u << i;                                                                     \
+	}                                                                                           \
+	return cleared;                                                                             \
+}                                                                                               \
+                                                                                                \
+static const bd_kernels kernels_##bits = { bits, collides_##bits, place_##bits, clear_rows_##bits };
+
+BOARD_KERNELS(16, uint16_t)
+BOARD_KERNELS(32, uint32_t)
+BOARD_KERNELS(64, uint64_t)
+
+/**
+ * Sets the size of the board, picks the kernels of its width class and empties it.
+ * @param tetris
+ * @param rows between BOARD_MIN_Y and BOARD_MAX_Y.
+ * @param cols between BOARD_MIN_X and BOARD_MAX_X.
+ * @return false if the size is out of range, the board is left unchanged then.
+ */
+bool bd_resize(tt_tetris *tetris, int rows, int cols) {
+	if (rows < BOARD_MIN_Y || rows > BOARD_MAX_Y || cols < BOARD_MIN_X || cols > BOARD_MAX_X) {
+		return false;
+	}
+	tetris->rows = rows;
+	tetris->cols = cols;
+	tetris->kernels = cols <= 16 ? &kernels_16 : cols <= 32 ? &kernels_32 : &kernels_64;
+	bd_clear(tetris);
+	return true;
+}
+
+/**
+ * Removes all occupied pixels of the board.
+ * @param tetris
+ */
+void bd_clear(tt_tetris *tetris) {
+	memset(tetris->board, 0, sizeof(tetris->board));
+	memset(&tetris->row_bits, 0, sizeof(tetris->row_bits));
+}
+
+/**
+ * Rebuilds the row words from the pixels, after the pixels have been written directly.
+ * @param tetris
+ */
+void bd_sync(tt_tetris *tetris) {
+	for (int y = 0; y < tetris->rows; y++) {
+		uint64_t bits = 0;
+		for (int x = 0; x < tetris->cols; x++) {
+			bits |= (uint64_t)(tetris->board[y][x] != 0) << x;
+		}
+		switch (tetris->kernels->width_class) {
+		case 16: tetris->row_bits.w16[y] = bits; break;
+		case 32: tetris->row_bits.w32[y] = bits; break;
+		default: tetris->row_bits.w64[y] = bits; break;
+		}
+	}
+}
+
+/**
+ * Returns how many rows the block can fall before it lands, but at most limit rows.
+ * @param tetris
+ * @param block
+ * @param limit
+ * @return
+ */
+int bd_drop_distance(const tt_tetris *tetris, const tetris_block *block, int limit) {
+	int distance = 0;
+	while (distance < limit && !tetris->kernels->collides(tetris, block, 0, distance + 1)) {
+		++distance;
+	}
+	return distance;
+}
+
+/**
+ * Measures the surface of a board: the row of the highest occupied tile of every column, rows if
+ * the column is empty. The columns right of the board are padded with INT8_MAX.
+ * The board is walked top down on its row words, a column gets its top in the first row it is
+ * occupied in.
+ * @param tetris
+ * @param tops BD_SURFACE values the surface is written to.
+ */
+void bd_surface(const tt_tetris *tetris, int8_t *tops) {
+	uint64_t reached = 0;
+	memset(tops, tetris->rows, tetris->cols);
+	memset(tops + tetris->cols, INT8_MAX, BD_SURFACE - tetris->cols);
+	for (int y = 0; y < tetris->rows; y++) {
+		uint64_t row;
+		switch (tetris->kernels->width_class) {
+		case 16: row = tetris->row_bits.w16[y]; break;
+		case 32: row = tetris->row_bits.w32[y]; break;
+		default: row = tetris->row_bits.w64[y]; break;
+		}
+		for (uint64_t fresh = row & ~reached; fresh; fresh &= fresh - 1) {
+			tops[__builtin_ctzll(fresh)] = (int8_t)y;
+		}
+		reached |= row;
+	}
+}
+
+/**
+ * Measures the bottom of a block.
+ * @param block
+ * @param profile
+ */
+void bd_block_profile(const tetris_block *block, bd_profile *profile) {
+	profile->first = -1;
+	profile->count = 0;
+	for (int x = 0; x < block->width; x++) {
+		int bottom = -1;
+		for (int y = 0; y < block->width; y++) {
+			if (block->array[y][x]) bottom = y;
+		}
+		if (bottom < 0) continue;
+		if (profile->first < 0) profile->first = x;
+		profile->bottom[profile->count++] = (int8_t)bottom;
+	}
+}
+
+/**
+ * Computes the landing rows of bd_landing_rows one column after another, without SIMD.
+ * @param tops surface of the board.
+ * @param profiles one per rotation.
+ * @param count number of rotations.
+ * @param cols width of the board.
+ * @param rows count rows of BD_LANES landing rows.
+ */
+void bd_landing_rows_scalar(const int8_t *tops, const bd_profile *profiles, int count, int cols, int8_t (*rows)[BD_LANES]) {
+	for (int r = 0; r < count; r++) {
+		const bd_profile *profile = &profiles[r];
+		for (int x = 0; x + profile->count <= cols; x++) {
+			int landing = INT8_MAX;
+			for (int k = 0; k < profile->count; k++) {
+				int row = tops[x + k] - profile->bottom[k] - 1;
+				if (row < landing) landing = row;
+			}
+			rows[r][x] = (int8_t)landing;
+		}
+	}
+}
+
+#ifdef BD_AVX2
+/**
+ * Computes the landing rows of bd_landing_rows for 32 columns per instruction: the surface is
+ * loaded shifted by every occupied column of the block, lowered by its bottom and the minimum is
+ * kept. Surfaces and landing rows fit a byte, boards are at most 64 rows high.
+ * @param tops surface of the board.
+ * @param profiles one per rotation.
+ * @param count number of rotations.
+ * @param cols width of the board.
+ * @param rows count rows of BD_LANES landing rows.
+ */
+__attribute__((target("avx2")))
+static void landing_rows_avx2(const int8_t *tops, const bd_profile *profiles, int count, int cols, int8_t (*rows)[BD_LANES]) {
+	for (int r = 0; r < count; r++) {
+		const bd_profile *profile = &profiles[r];
+		for (int x = 0; x + profile->count <= cols; x += 32) {
+			__m256i landing = _mm256_set1_epi8(INT8_MAX);
+			for (int k = 0; k < profile->count; k++) {
+				__m256i top = _mm256_loadu_si256((const __m256i *)(tops + x + k));
+				landing = _mm256_min_epi8(landing, _mm256_sub_epi8(top, _mm256_set1_epi8(profile->bottom[k] + 1)));
+			}
+			_mm256_storeu_si256((__m256i *)(rows[r] + x), landing);
+		}
+	}
+}
+#endif
+
+/**
+ * Computes where a block dropped from above the stack lands, for every column and any number of
+ * its rotations at once: the row its box comes to rest in is the smallest distance between the
+ * surface and the bottom of the block over all its columns. Entry x of a rotation stands for the
+ * block whose first occupied column is column x of the board, entries from cols - count + 1 on
+ * are undefined. A row above the board means the block cannot be dropped there from the top.
+ * Runs the AVX2 kernel if the processor has it, else bd_landing_rows_scalar.
+ * @param tops surface of the board.
+ * @param profiles one per rotation.
+ * @param count number of rotations.
+ * @param cols width of the board.
+ * @param rows count rows of BD_LANES landing rows.
+ */
+void bd_landing_rows(const int8_t *tops, const bd_profile *profiles, int count, int cols, int8_t (*rows)[BD_LANES]) {
+#ifdef BD_AVX2
+	if (__builtin_cpu_supports("avx2")) {
+		landing_rows_avx2(tops, profiles, count, cols, rows);
+		return;
+	}
+#endif
+	bd_landing_rows_scalar(tops, profiles, count, cols, rows);
+}
+
+/**
+ * Names the kernel bd_landing_rows runs on this processor.
+ * @return "avx2" or "scalar".
+ */
+const char *bd_landing_kernel(void) {
+#ifdef BD_AVX2
+	if (__builtin_cpu_supports("avx2")) return "avx2";
+#endif
+	return "scalar";
+}
@@ -0,0 +1,119 @@
+#ifndef TT_BOARD_H
+#define TT_BOARD_H
+
+#include "tt_types.h"
+
+/** Defines the smallest height a board can be given, blocks have to be able to spawn. */
+#define BOARD_MIN_Y 4
+/** Defines the smallest width a board can be given, the I block has to fit lying. */
+#define BOARD_MIN_X 4
+
+/** Bytes of a surface: the top of every column followed by padding the landing kernel may read. */
+#define BD_SURFACE 96
+
+/** Landing rows computed per rotation, one for every column of the widest board. */
+#define BD_LANES BOARD_MAX_X
+
+/**
+ * The hot board operations, specialized for boards of up to 16, 32 and 64 columns, so every row
+ * is a single machine word of the matching size and a whole block row is tested with one AND.
+ *  - width_class: number of bits of a row word
+ *  - collides: true if the block moved by the offset overlaps the stack or leaves the board
+ *  - place: adds the block to the board
+ *  - clear_rows: removes the full rows among count rows starting at first, top to bottom, and
+ *    returns them as mask (bit i stands for row first + i)
+ */
+typedef struct bd_kernels {
+	int width_class;
+	bool (*collides)(const tt_tetris *tetris, const tetris_block *block, int x_move, int y_move);
+	void (*place)(tt_tetris *tetris, const tetris_block *block);
+	unsigned (*clear_rows)(tt_tetris *tetris, int first, int count);
+} bd_kernels;
+
+/**
+ * The bottom of a block in one rotation: the occupied columns of its box, which lie side by side
+ * in every tetromino, and the lowest occupied row of the box in each of them.
+ */
+typedef struct {
+	int first;
+	int count;
+	int8_t bottom[4];
+} bd_profile;
+
+/**
+ * Sets the size of the board, picks the kernels of its width class and empties it.
+ * @param tetris
+ * @param rows between BOARD_MIN_Y and BOARD_MAX_Y.
+ * @param cols between BOARD_MIN_X and BOARD_MAX_X.
+ * @return false if the size is out of range, the board is left unchanged then.
+ */
+bool bd_resize(tt_tetris *tetris, int rows, int cols);
+
+/**
+ * Removes all occupied pixels of the board.
+ * @param tetris
+ */
+void bd_clear(tt_tetris *tetris);
+
+/**
+ * Rebuilds the row words from the pixels, after the pixels have been written directly.
+ * @param tetris
+ */
+void bd_sync(tt_tetris *tetris);
+
+/**
+ * Returns how many rows the block can fall before it lands, but at most limit rows.
+ * @param tetris
+ * @param block
+ * @param limit
+ * @return
+ */
+int bd_drop_distance(const tt_tetris *tetris, const tetris_block *block, int limit);
+
+/**
+ * Measures the surface of a board: the row of the highest occupied tile of every column, rows if
+ * the column is empty. The columns right of the board are padded with INT8_MAX.
+ * @param tetris
+ * @param tops BD_SURFACE values the surface is written to.
+ */
+void bd_surface(const tt_tetris *tetris, int8_t *tops);
+
+/**
+ * Measures the bottom of a block.
+ * @param block
+ * @param profile
+ */
+void bd_block_profile(const tetris_block *block, bd_profile *profile);
+
+/**
+ * Computes where a block dropped from above the stack lands, for every column and any number of
+ * its rotations at once: the row its box comes to rest in is the smallest distance between the
+ * surface and the bottom of the block over all its columns. Entry x of a rotation stands for the
+ * block whose first occupied column is column x of the board, entries from cols - count + 1 on
+ * are undefined. A row above the board means the block cannot be dropped there from the top.
+ * Runs the AVX2 kernel if the processor has it, else bd_landing_rows_scalar.
+ * @param tops surface of the board.
+ * @param profiles one per rotation.
+ * @param count number of rotations.
+ * @param cols width of the board.
+ * @param rows count rows of BD_LANES landing rows.
+ */
+void bd_landing_rows(const int8_t *tops, const bd_profile *profiles, int count, int cols, int8_t (*rows)[BD_LANES]);
+
+/**
+ * Computes the landing rows of bd_landing_rows one column after another, without SIMD.
+ * @param tops surface of the board.
+ * @param profiles one per rotation.
+ * @param count number of rotations.
+ * @param cols width of the board.
+ * @param rows count rows of BD_LANES landing rows.
+ */
+void bd_landing_rows_scalar(const int8_t *tops, const bd_profile *profiles, int count, int cols, int8_t (*rows)[BD_LANES]);
+
+/**
+ * Names the kernel bd_landing_rows runs on this processor.
+ * @return "avx2" or "scalar".
+ */
+const char *bd_landing_kernel(void);
+
+#endif // TT_BOARD_H
@@ -0,0 +1,547 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <time.h>
+
+#include "tt_board.h"
+#include "tt_bot.h"
+#include "tt_game.h"
+
+/** Rating of a placement the game is over after. */
+#define GAME_OVER_RATING -1e12
+
+/**
+ * Walks all placements of the current block, with the inputs bt_apply_move feeds: the block is
+ * rotated on a fresh copy of the game, pushed to the left wall and then moved right column by
+ * column till the right wall. The landing rows of every column are computed at once for each
+ * rotation from the surface of the board.
+ */
+typedef struct {
+	tt_tetris *rotated;
+	int rotations;
+	int shift;
+	int8_t tops[BD_SURFACE];
+	bd_profile profile;
+	int8_t landing[1][BD_LANES];
+} placement_walk;
+
+/** Hand tuned weights, used as long as no better ones are given. */
+const bt_weights bt_default_weights = { { 0.76, -0.51, -0.36, -0.18, -0.05, -0.02 } };
+
+/**
+ * Reads the word of a board row, whatever the width class of the board.
+ * @param tetris
+ * @param y
+ * @return the row with bit x set for every occupied pixel in column x.
+ */
+static uint64_t row_word(const tt_tetris *tetris, int y) {
+	switch (tetris->kernels->width_class) {
+		case 16: return tetris->row_bits.w16[y];
+		case 32: return tetris->row_bits.w32[y];
+		default: return tetris->row_bits.w64[y];
+	}
+}
+
+/**
+ * Measures the columns of a board.
+ * The board is walked top down once on its row words: a column gets its height in the first row
+ * it is occupied in, every empty tile of a column that has been reached already is a hole.
+ * @param tetris game whose current board is measured.
+ * @param heights cols values the heights of the columns are written to.
+ * @return the number of holes.
+ */
+int bt_heights(const tt_tetris *tetris, int *heights) {
+	uint64_t reached = 0, all = tetris->cols == 64 ? ~0ULL : (1ULL << tetris->cols) - 1;
+	int holes = 0;
+	memset(heights, 0, sizeof(int) * tetris->cols);
+	for (int y = 0; y < tetris->rows; y++) {
+		uint64_t row = row_word(tetris, y);
+		for (uint64_t fresh = row & ~reached; fresh; fresh &= fresh - 1) {
+			heights[__builtin_ctzll(fresh)] = tetris->rows - y;
+		}
+		holes += __builtin_popcountll(reached & ~row & all);
+		reached |= row;
+	}
+	return holes;
+}
+
+/**
+ * Computes the board features of a game.
+ * @param tetris game whose current board is measured.
+ * @param lines rows cleared by the block locked last.
+ * @param features BT_FEATURES values the features are written to.
+ */
+void bt_features(const tt_tetris *tetris, int lines, double *features) {
+	int heights[BOARD_MAX_X];
+	int holes = bt_heights(tetris, heights);
+
+	int height = 0, max_height = 0, bumpiness = 0, wells = 0;
+	for (int x = 0; x < tetris->cols; x++) {
+		height += heights[x];
+		if (heights[x] > max_height) max_height = heights[x];
+		if (x) bumpiness += abs(heights[x] - heights[x - 1]);
+		int left = x ? heights[x - 1] : tetris->rows, right = x + 1 < tetris->cols ? heights[x + 1] : tetris->rows;
+		int depth = (left < right ? left : right) - heights[x];
+		if (depth > 0) wells += depth;
+	}
+	features[BT_LINES] = lines;
+	features[BT_HEIGHT] = height;
+	features[BT_HOLES] = holes;
+	features[BT_BUMPINESS] = bumpiness;
+	features[BT_WELLS] = wells;
+	features[BT_MAX_HEIGHT] = max_height;
+}
+
+/**
+ * Rates a board by the weighted sum of its features.
+ * @param tetris
+ * @param lines rows cleared by the block locked last.
+ * @param weights
+ * @return the rating, higher is better.
+ */
+double bt_evaluate(const tt_tetris *tetris, int lines, const bt_weights *weights) {
+	double features[BT_FEATURES], rating = 0;
+	bt_features(tetris, lines, features);
+	for (int i = 0; i < BT_FEATURES; i++) {
+		rating += weights->weights[i] * features[i];
+	}
+	return rating;
+}
+
+/**
+ * Starts a walk over the placements of a block.
+ * @param walk
+ * @param rotated game the walk moves the block on.
+ * @param tetris game whose block is placed.
+ */
+static void start_walk(placement_walk *walk, tt_tetris *rotated, const tt_tetris *tetris) {
+	bd_surface(tetris, walk->tops);
+	walk->rotated = rotated;
+	walk->rotations = -1;
+	walk->shift = 0;
+}
+
+/**
+ * Moves a walk to the next placement of the current block of a game. The block stands in the
+ * column of the placement in walk->rotated afterwards, it still has to be dropped.
+ * @param tetris
+ * @param walk
+ * @param move set to the inputs leading to the placement.
+ * @return false once all placements have been walked.
+ */
+static bool next_placement(const tt_tetris *tetris, placement_walk *walk, bt_move *move) {
+	tt_tetris *rotated = walk->rotated;
+	if (walk->rotations < 0 || would_collide(rotated, rotated->current_block, 1, 0)) {
+		if (++walk->rotations == 4) {
+			return false;
+		}
+		*rotated = *tetris;
+		for (int i = 0; i < walk->rotations; i++) {
+			gm_move_block(rotated, TT_ROTATE);
+		}
+		while (!would_collide(rotated, rotated->current_block, -1, 0)) {
+			gm_move_block(rotated, TT_LEFT);
+		}
+		walk->shift = 0;
+		bd_block_profile(&rotated->current_block, &walk->profile);
+		bd_landing_rows(walk->tops, &walk->profile, 1, rotated->cols, walk->landing);
+	} else {
+		gm_move_block(rotated, TT_RIGHT);
+		++walk->shift;
+	}
+	*move = (bt_move){ walk->rotations, walk->shift };
+	return true;
+}
+
+/**
+ * Drops the block of a walk at its current placement and rates the board after the line clears.
+ * A block above its landing row falls straight onto the surface and is locked there; only a
+ * block already below the surface of a column, under an overhang at the top, is dropped row by
+ * row.
+ * @param walk
+ * @param placed game the block is dropped in.
+ * @param lines_before lines cleared in the game the rows cleared are counted from.
+ * @param weights
+ * @return the rating.
+ */
+static double rate_placement(const placement_walk *walk, tt_tetris *placed, unsigned lines_before, const bt_weights *weights) {
+	tetris_block block = walk->rotated->current_block;
+	int landing = walk->landing[0][block.x + walk->profile.first];
+	*placed = *walk->rotated;
+	if (landing >= block.y) {
+		block.y = landing;
+		gm_lock_block(placed, block);
+	} else {
+		gm_move_block(placed, TT_FALL_DOWN);
+	}
+	return bt_evaluate(placed, placed->lines - lines_before, weights);
+}
+
+/**
+ * Tries every rotation and column for the current block and picks the best rated placement.
+ * Every placement is played on a copy of the game with the same inputs bt_apply_move feeds, so
+ * only placements the game accepts are rated, and rated on the board after the line clears.
+ * @param tetris
+ * @param weights
+ * @return the best placement.
+ */
+bt_move bt_best_move(const tt_tetris *tetris, const bt_weights *weights) {
+	tt_tetris rotated, placed;
+	placement_walk walk;
+	bt_move best = { 0, 0 }, move;
+	double best_rating = 0;
+	bool found = false;
+	start_walk(&walk, &rotated, tetris);
+	while (next_placement(tetris, &walk, &move)) {
+		double rating = rate_placement(&walk, &placed, tetris->lines, weights);
+		if (!found || rating > best_rating) {
+			best = move;
+			best_rating = rating;
+			found = true;
+		}
+	}
+	return best;
+}
+
+/**
+ * Feeds the inputs of a placement to the game up to the hard drop, so the block is left above
+ * its place for gravity to drop it.
+ * @param tetris
+ * @param move
+ */
+void bt_steer(tt_tetris *tetris, bt_move move) {
+	for (int i = 0; i < move.rotations; i++) {
+		gm_move_block(tetris, TT_ROTATE);
+	}
+	while (!would_collide(tetris, tetris->current_block, -1, 0)) {
+		gm_move_block(tetris, TT_LEFT);
+	}
+	for (int i = 0; i < move.shift; i++) {
+		gm_move_block(tetris, TT_RIGHT);
+	}
+}
+
+/**
+ * Feeds the inputs of a placement to the game, ending with a hard drop.
+ * @param tetris
+ * @param move
+ */
+void bt_apply_move(tt_tetris *tetris, bt_move move) {
+	bt_steer(tetris, move);
+	gm_move_block(tetris, TT_FALL_DOWN);
+}
+
+/**
+ * Lets the bot play a game till it is over or a number of blocks has been placed.
+ * @param tetris game to play, seeded before.
+ * @param weights
+ * @param max_pieces
+ * @return the number of lines cleared.
+ */
+unsigned bt_play(tt_tetris *tetris, const bt_weights *weights, unsigned max_pieces) {
+	while (!gm_is_game_over(tetris) && tetris->block_count < max_pieces) {
+		bt_apply_move(tetris, bt_best_move(tetris, weights));
+	}
+	return tetris->lines;
+}
+
+/**
+ * Reads the monotonic clock.
+ * @return the current time in nanoseconds.
+ */
+static long long now_ns() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+/**
+ * Sorts nodes by their rating, best first, keeping the order of equally rated ones. The sort runs
+ * in place by insertion, as qsort may allocate a buffer, and a share holds at most BT_PLACEMENTS.
+ * @param nodes
+ * @param count
+ */
+static void sort_nodes(bt_node *nodes, int count) {
+	for (int i = 1; i < count; i++) {
+		bt_node node = nodes[i];
+		int j = i;
+		for (; j > 0 && nodes[j - 1].rating < node.rating; j--) {
+			nodes[j] = nodes[j - 1];
+		}
+		nodes[j] = node;
+	}
+}
+
+/**
+ * Rates the share of a worker among the placements of the current block: placement i belongs to
+ * worker i % threads. The nodes rated are sorted best first afterwards, even if the deadline cut
+ * the share short.
+ * @param worker
+ * @return false if the deadline passed first.
+ */
+static bool rate_roots(bt_worker *worker) {
+	const bt_searcher *searcher = worker->searcher;
+	const tt_tetris *tetris = searcher->tetris;
+	placement_walk walk;
+	bt_move move;
+	start_walk(&walk, &worker->games[0], tetris);
+	worker->count = 0;
+	for (int i = 0; next_placement(tetris, &walk, &move); i++) {
+		if (i % searcher->threads != worker->index) {
+			continue;
+		}
+		if (now_ns() >= searcher->deadline_ns) {
+			break;
+		}
+		double rating = rate_placement(&walk, &worker->games[1], tetris->lines, &searcher->weights);
+		worker->nodes[worker->count++] = (bt_node){ move, rating, 0, false };
+		++worker->placements;
+	}
+	sort_nodes(worker->nodes, worker->count);
+	return walk.rotations == 4;
+}
+
+/**
+ * Looks ahead from a placement of the current block: places it and rates the best placement of
+ * the next block on top, counting the lines both cleared.
+ * @param worker
+ * @param node
+ * @return false if the deadline passed first.
+ */
+static bool expand(bt_worker *worker, bt_node *node) {
+	const bt_searcher *searcher = worker->searcher;
+	tt_tetris *root = &worker->games[2];
+	placement_walk walk;
+	bt_move move;
+	*root = *searcher->tetris;
+	bt_apply_move(root, node->move);
+	node->deep_rating = GAME_OVER_RATING;
+	if (!gm_is_game_over(root)) {
+		start_walk(&walk, &worker->games[0], root);
+		while (next_placement(root, &walk, &move)) {
+			if (now_ns() >= searcher->deadline_ns) {
+				return false;
+			}
+			double rating = rate_placement(&walk, &worker->games[1], searcher->tetris->lines, &searcher->weights);
+			if (rating > node->deep_rating) node->deep_rating = rating;
+			++worker->placements;
+		}
+	}
+	node->expanded = true;
+	return true;
+}
+
+/**
+ * Searches the share of a worker till all of it has been looked ahead from or the deadline
+ * passes. The placements rated alone count even if the deadline cut them short; after that every
+ * round looks ahead from twice as many of the best rated placements as the round before and only
+ * completed rounds count.
+ * @param worker
+ */
+static void search(bt_worker *worker) {
+	worker->depth = 0;
+	worker->placements = 0;
+	bool complete = rate_roots(worker);
+	if (!worker->count) {
+		return;
+	}
+	worker->best[1] = worker->nodes[0];
+	worker->depth = 1;
+	if (!complete) {
+		return;
+	}
+	for (int beam = BT_FIRST_BEAM; ; beam *= 2) {
+		if (beam > worker->count) {
+			beam = worker->count;
+		}
+		bt_node *best = NULL;
+		for (int i = 0; i < beam; i++) {
+			if (!worker->nodes[i].expanded && !expand(worker, &worker->nodes[i])) {
+				return;
+			}
+			if (!best || worker->nodes[i].deep_rating > best->deep_rating) {
+				best = &worker->nodes[i];
+			}
+		}
+		worker->best[2] = *best;
+		worker->depth = 2;
+		if (beam == worker->count) {
+			return;
+		}
+	}
+}
+
+/**
+ * Waits for searches and runs them. Runs on every thread of the pool.
+ * @param arg the worker.
+ * @return NULL
+ */
+static void *work(void *arg) {
+	bt_worker *worker = arg;
+	bt_searcher *searcher = worker->searcher;
+	unsigned round = 0;
+	pthread_mutex_lock(&searcher->lock);
+	while (true) {
+		while (!searcher->quit && searcher->round == round) {
+			pthread_cond_wait(&searcher->wake, &searcher->lock);
+		}
+		if (searcher->quit) {
+			break;
+		}
+		round = searcher->round;
+		pthread_mutex_unlock(&searcher->lock);
+		search(worker);
+		pthread_mutex_lock(&searcher->lock);
+		worker->round = round;
+		if (--searcher->busy == 0) {
+			pthread_cond_signal(&searcher->done);
+		}
+	}
+	pthread_mutex_unlock(&searcher->lock);
+	return NULL;
+}
+
+/**
+ * Waits with the lock of the pool held till no worker is busy or the time is up.
+ * @param searcher
+ * @param until time on the monotonic clock to give up at.
+ * @return false if some workers are still busy.
+ */
+static bool wait_for_workers(bt_searcher *searcher, const struct timespec *until) {
+	while (searcher->busy) {
+		if (pthread_cond_timedwait(&searcher->done, &searcher->lock, until) == ETIMEDOUT) {
+			return !searcher->busy;
+		}
+	}
+	return true;
+}
+
+/**
+ * Starts the threads of a search pool and allocates their arenas.
+ * @param searcher
+ * @param threads number of workers.
+ * @return false if the arenas could not be allocated or no thread could be started.
+ */
+bool bt_init_searcher(bt_searcher *searcher, int threads) {
+	searcher->workers = calloc(threads, sizeof(bt_worker));
+	searcher->tetris = malloc(sizeof(tt_tetris));
+	searcher->threads = 0;
+	searcher->round = 0;
+	searcher->busy = 0;
+	searcher->quit = false;
+	// the caller waits for the workers on the clock the deadline is taken from
+	pthread_condattr_t monotonic;
+	pthread_condattr_init(&monotonic);
+	pthread_condattr_setclock(&monotonic, CLOCK_MONOTONIC);
+	pthread_mutex_init(&searcher->lock, NULL);
+	pthread_cond_init(&searcher->wake, NULL);
+	pthread_cond_init(&searcher->done, &monotonic);
+	pthread_condattr_destroy(&monotonic);
+	for (int i = 0; searcher->workers && searcher->tetris && i < threads; i++) {
+		bt_worker *worker = &searcher->workers[i];
+		worker->searcher = searcher;
+		worker->index = i;
+		worker->nodes = malloc(BT_PLACEMENTS * sizeof(bt_node));
+		worker->games = malloc(3 * sizeof(tt_tetris));
+		if (!worker->nodes || !worker->games || pthread_create(&worker->thread, NULL, work, worker)) {
+			free(worker->nodes);
+			free(worker->games);
+			break;
+		}
+		++searcher->threads;
+	}
+	return searcher->threads > 0;
+}
+
+/**
+ * Stops the threads of a search pool and frees their arenas.
+ * @param searcher
+ */
+void bt_destroy_searcher(bt_searcher *searcher) {
+	pthread_mutex_lock(&searcher->lock);
+	searcher->quit = true;
+	pthread_cond_broadcast(&searcher->wake);
+	pthread_mutex_unlock(&searcher->lock);
+	for (int i = 0; i < searcher->threads; i++) {
+		pthread_join(searcher->workers[i].thread, NULL);
+		free(searcher->workers[i].nodes);
+		free(searcher->workers[i].games);
+	}
+	free(searcher->workers);
+	free(searcher->tetris);
+	pthread_cond_destroy(&searcher->done);
+	pthread_cond_destroy(&searcher->wake);
+	pthread_mutex_destroy(&searcher->lock);
+}
+
+/**
+ * Searches the best placement of the current block, looking ahead with the next block as far as
+ * the time allows. The best placement found when the budget runs out is returned; if not even
+ * the current block could be rated by then, there is none and the block is best left as it is.
+ * Ratings are only comparable between workers that looked equally far ahead, so the answer
+ * comes from the deepest look ahead all workers with a share completed.
+ * The workers search for BT_SEARCH_SHARE percent of the budget and the caller waits for them no
+ * longer than the budget, so it only overshoots by the time it takes to be woken. Workers that
+ * have not handed in by then are left out. Workers still busy with a search left behind are
+ * waited for within the budget as well; if they do not stop in time, nothing is searched.
+ * @param searcher
+ * @param tetris
+ * @param weights
+ * @param budget_us time the search may take in microseconds.
+ * @param move set to the best placement found.
+ * @return false if no placement could be rated in time.
+ */
+bool bt_search_move(bt_searcher *searcher, const tt_tetris *tetris, const bt_weights *weights, long long budget_us,
+                    bt_move *move) {
+	long long start = now_ns(), end = start + budget_us * 1000;
+	struct timespec until = { end / 1000000000, end % 1000000000 };
+	pthread_mutex_lock(&searcher->lock);
+	// workers left out of the last search stop soon, its deadline has passed
+	if (!wait_for_workers(searcher, &until)) {
+		searcher->depth = 0;
+		searcher->placements = 0;
+		searcher->late = searcher->threads;
+		pthread_mutex_unlock(&searcher->lock);
+		return false;
+	}
+	*searcher->tetris = *tetris;
+	searcher->weights = *weights;
+	searcher->deadline_ns = start + budget_us * 10 * BT_SEARCH_SHARE;
+	searcher->busy = searcher->threads;
+	++searcher->round;
+	pthread_cond_broadcast(&searcher->wake);
+	wait_for_workers(searcher, &until);
+
+	// only workers done with this search are read, the others may still write to theirs
+	int depth = 2;
+	searcher->placements = 0;
+	searcher->late = 0;
+	for (int i = 0; i < searcher->threads; i++) {
+		const bt_worker *worker = &searcher->workers[i];
+		if (worker->round != searcher->round) {
+			++searcher->late;
+			continue;
+		}
+		searcher->placements += worker->placements;
+		// a worker without a share has nothing to say
+		if (worker->count && worker->depth < depth) depth = worker->depth;
+	}
+	searcher->depth = searcher->late == searcher->threads ? 0 : depth;
+	const bt_node *best = NULL;
+	for (int i = 0; searcher->depth && i < searcher->threads; i++) {
+		const bt_worker *worker = &searcher->workers[i];
+		if (worker->round != searcher->round || !worker->count) {
+			continue;
+		}
+		const bt_node *node = &worker->best[depth];
+		double rating = depth == 2 ? node->deep_rating : node->rating;
+		if (!best || rating > (depth == 2 ? best->deep_rating : best->rating)) {
+			best = node;
+		}
+	}
+	if (best) {
+		*move = best->move;
+	}
+	pthread_mutex_unlock(&searcher->lock);
+	return best != NULL;
+}
@@ -0,0 +1,195 @@
+#ifndef TT_BOT_H
+#define TT_BOT_H
+
+#include <pthread.h>
+
+#include "tt_types.h"
+
+/**
+ * Board features the bot weighs, all taken from the board after the block locked and the full
+ * rows have been cleared:
+ *  - BT_LINES: rows cleared by the block
+ *  - BT_HEIGHT: sum of the heights of all columns
+ *  - BT_HOLES: empty tiles with an occupied tile somewhere above them
+ *  - BT_BUMPINESS: sum of the height differences of neighbouring columns
+ *  - BT_WELLS: sum of the depths of columns lower than both neighbours
+ *  - BT_MAX_HEIGHT: height of the highest column
+ */
+enum bt_feature { BT_LINES, BT_HEIGHT, BT_HOLES, BT_BUMPINESS, BT_WELLS, BT_MAX_HEIGHT, BT_FEATURES };
+
+/**
+ * One weight per board feature. A placement is rated by the weighted sum of its features.
+ */
+typedef struct {
+	double weights[BT_FEATURES];
+} bt_weights;
+
+/**
+ * A placement of the current block, given as the inputs that lead to it: the block is rotated,
+ * pushed to the left wall, moved right by shift columns and dropped.
+ */
+typedef struct {
+	int rotations;
+	int shift;
+} bt_move;
+
+/** Number of placements a block can have at most, one per rotation and column. */
+#define BT_PLACEMENTS (4 * BOARD_MAX_X)
+
+/** Placements of the current block the first deepening round looks ahead from, per worker. */
+#define BT_FIRST_BEAM 4
+
+/** Percentage of the budget the workers search for, the rest is left for them to hand in. */
+#define BT_SEARCH_SHARE 90
+
+/**
+ * A placement of the current block in a search. rating rates the board after the placement
+ * alone, deep_rating the board after the best placement of the next block on top of it, once
+ * the node has been expanded.
+ */
+typedef struct {
+	bt_move move;
+	double rating;
+	double deep_rating;
+	bool expanded;
+} bt_node;
+
+/**
+ * A thread of the search pool. Its arena of nodes and the games it plays placements on are
+ * allocated with the pool, so searching never allocates memory.
+ * best[d] is the best node found looking d blocks ahead, depth the deepest completed look ahead,
+ * round the last search it completed.
+ */
+typedef struct {
+	pthread_t thread;
+	struct bt_searcher *searcher;
+	int index;
+	bt_node *nodes;
+	int count;
+	tt_tetris *games;
+	int depth;
+	bt_node best[3];
+	unsigned long long placements;
+	unsigned round;
+} bt_worker;
+
+/**
+ * A pool of threads searching placements for the current and the next block within a deadline.
+ * The placements of the current block are split among the workers. Every worker rates its share
+ * on its own first, then looks ahead with the next block from its best placements, doubling
+ * their number every round, till all are looked ahead from or the deadline passes.
+ * The workers search on copies of the game and weights held by the pool, so a worker still busy
+ * when the caller stops waiting never reads from the caller.
+ * After a search depth and placements tell how far it got, late tells the workers left out.
+ */
+typedef struct bt_searcher {
+	bt_worker *workers;
+	int threads;
+	pthread_mutex_t lock;
+	pthread_cond_t wake, done;
+	unsigned round;
+	int busy;
+	bool quit;
+
+	tt_tetris *tetris;
+	bt_weights weights;
+	long long deadline_ns;
+
+	int depth;
+	unsigned long long placements;
+	int late;
+} bt_searcher;
+
+/** Hand tuned weights, used as long as no better ones are given. */
+extern const bt_weights bt_default_weights;
+
+/**
+ * Measures the columns of a board.
+ * @param tetris game whose current board is measured.
+ * @param heights cols values the heights of the columns are written to.
+ * @return the number of holes.
+ */
+int bt_heights(const tt_tetris *tetris, int *heights);
+
+/**
+ * Computes the board features of a game.
+ * @param tetris game whose current board is measured.
+ * @param lines rows cleared by the block locked last.
+ * @param features BT_FEATURES values the features are written to.
+ */
+void bt_features(const tt_tetris *tetris, int lines, double *features);
+
+/**
+ * Rates a board by the weighted sum of its features.
+ * @param tetris
+ * @param lines rows cleared by the block locked last.
+ * @param weights
+ * @return the rating, higher is better.
+ */
+double bt_evaluate(const tt_tetris *tetris, int lines, const bt_weights *weights);
+
+/**
+ * Tries every rotation and column for the current block and picks the best rated placement.
+ * @param tetris
+ * @param weights
+ * @return the best placement.
+ */
+bt_move bt_best_move(const tt_tetris *tetris, const bt_weights *weights);
+
+/**
+ * Feeds the inputs of a placement to the game up to the hard drop, so the block is left above
+ * its place for gravity to drop it.
+ * @param tetris
+ * @param move
+ */
+void bt_steer(tt_tetris *tetris, bt_move move);
+
+/**
+ * Feeds the inputs of a placement to the game, ending with a hard drop.
+ * @param tetris
+ * @param move
+ */
+void bt_apply_move(tt_tetris *tetris, bt_move move);
+
+/**
+ * Lets the bot play a game till it is over or a number of blocks has been placed.
+ * @param tetris game to play, seeded before.
+ * @param weights
+ * @param max_pieces
+ * @return the number of lines cleared.
+ */
+unsigned bt_play(tt_tetris *tetris, const bt_weights *weights, unsigned max_pieces);
+
+/**
+ * Starts the threads of a search pool and allocates their arenas.
+ * @param searcher
+ * @param threads number of workers.
+ * @return false if the arenas could not be allocated or no thread could be started.
+ */
+bool bt_init_searcher(bt_searcher *searcher, int threads);
+
+/**
+ * Stops the threads of a search pool and frees their arenas.
+ * @param searcher
+ */
+void bt_destroy_searcher(bt_searcher *searcher);
+
+/**
+ * Searches the best placement of the current block, looking ahead with the next block as far as
+ * the time allows. The best placement found when the budget runs out is returned; if not even
+ * the current block could be rated by then, there is none and the block is best left as it is.
+ * The workers search for BT_SEARCH_SHARE percent of the budget and the caller waits for them no
+ * longer than the budget, so it only overshoots by the time it takes to be woken. Workers that
+ * have not handed in by then are left out. Workers still busy with a search left behind are
+ * waited for within the budget as well; if they do not stop in time, nothing is searched.
+ * @param searcher
+ * @param tetris
+ * @param weights
+ * @param budget_us time the search may take in microseconds.
+ * @param move set to the best placement found.
+ * @return false if no placement could be rated in time.
+ */
+bool bt_search_move(bt_searcher *searcher, const tt_tetris *tetris, const bt_weights *weights, long long budget_us,
+                    bt_move *move);
+
+#endif // TT_BOT_H
@@ -0,0 +1,168 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "tt_cache.h"
+
+/**
+ * Mixes a value into a hash (FNV-1a over its bytes).
+ * @param hash
+ * @param value
+ * @return
+ */
+static uint64_t mix(uint64_t hash, uint8_t value) {
+	return (hash ^ value) * 0x100000001b3ULL;
+}
+
+/**
+ * Computes the key of the decision the current block of a game stands for. It combines the width
+ * of the board, the contour of the stack, the current and the next block. The contour is given
+ * by the heights of the columns above the lowest one, capped at PC_MAX_STEP, so positions that
+ * only differ further down the stack share their key.
+ * @param tetris
+ * @return
+ */
+uint64_t pc_key(const tt_tetris *tetris) {
+	int heights[BOARD_MAX_X], lowest = tetris->rows;
+	bt_heights(tetris, heights);
+	for (int x = 0; x < tetris->cols; x++) {
+		if (heights[x] < lowest) lowest = heights[x];
+	}
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	hash = mix(hash, (uint8_t)tetris->cols);
+	for (int x = 0; x < tetris->cols; x++) {
+		int step = heights[x] - lowest;
+		hash = mix(hash, (uint8_t)(step < PC_MAX_STEP ? step : PC_MAX_STEP));
+	}
+	hash = mix(hash, tetris->current_block.color);
+	return mix(hash, tetris->next_block.color);
+}
+
+/**
+ * Maps a placement cache file.
+ * @param cache
+ * @param path
+ * @return false if the file is missing or no placement cache.
+ */
+bool pc_open(pc_cache *cache, const char *path) {
+	memset(cache, 0, sizeof(*cache));
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat info;
+	void *map = MAP_FAILED;
+	if (!fstat(fd, &info) && (size_t)info.st_size >= sizeof(pc_file)) {
+		map = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	}
+	close(fd);
+	if (map == MAP_FAILED) {
+		return false;
+	}
+	cache->file = map;
+	cache->size = info.st_size;
+	if (cache->file->magic != PC_MAGIC ||
+	    cache->size < sizeof(pc_file) + (size_t)cache->file->count * sizeof(pc_entry)) {
+		pc_close(cache);
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Unmaps a placement cache file.
+ * @param cache
+ */
+void pc_close(pc_cache *cache) {
+	if (cache->file) {
+		munmap((void *)cache->file, cache->size);
+		cache->file = NULL;
+	}
+}
+
+/**
+ * Looks up the placement of the current block of a game and counts the hit or miss.
+ * The entries are searched by bisection on their keys.
+ * @param cache
+ * @param tetris
+ * @param move set to the cached placement on a hit.
+ * @return false on a miss.
+ */
+bool pc_lookup(pc_cache *cache, const tt_tetris *tetris, bt_move *move) {
+	uint64_t key = pc_key(tetris);
+	const pc_entry *entries = cache->file->entries;
+	uint32_t low = 0, high = cache->file->count;
+	while (low < high) {
+		uint32_t middle = low + (high - low) / 2;
+		if (entries[middle].key < key) low = middle + 1;
+		else high = middle;
+	}
+	if (low == cache->file->count || entries[low].key != key) {
+		++cache->misses;
+		return false;
+	}
+	*move = (bt_move){ entries[low].rotations, entries[low].shift };
+	++cache->hits;
+	return true;
+}
+
+/**
+ * Sorts entries by key and, for the same key, by placement.
+ * @param a
+ * @param b
+ * @return
+ */
+static int compare_entries(const void *a, const void *b) {
+	const pc_entry *x = a, *y = b;
+	if (x->key != y->key) return (x->key > y->key) - (x->key < y->key);
+	if (x->rotations != y->rotations) return x->rotations - y->rotations;
+	return x->shift - y->shift;
+}
+
+/**
+ * Writes decisions to a placement cache file. Decisions taken more than once keep the placement
+ * chosen most often. The entries are sorted in place and the file is replaced at once.
+ * @param path
+ * @param entries
+ * @param count
+ * @return the number of entries written, 0 if the file could not be written.
+ */
+uint32_t pc_write(const char *path, pc_entry *entries, uint32_t count) {
+	qsort(entries, count, sizeof(pc_entry), compare_entries);
+	// runs of the same placement follow each other within a key, the longest run wins
+	uint32_t kept = 0;
+	for (uint32_t i = 0, best_run = 0; i < count;) {
+		uint32_t run = 1;
+		while (i + run < count && !compare_entries(&entries[i], &entries[i + run])) {
+			++run;
+		}
+		if (kept && entries[kept - 1].key == entries[i].key) {
+			if (run > best_run) {
+				entries[kept - 1] = entries[i];
+				best_run = run;
+			}
+		} else {
+			entries[kept++] = entries[i];
+			best_run = run;
+		}
+		i += run;
+	}
+
+	char temporary[4096];
+	snprintf(temporary, sizeof(temporary), "%s.tmp", path);
+	FILE *file = fopen(temporary, "wb");
+	if (!file) {
+		return 0;
+	}
+	pc_file header = { PC_MAGIC, kept };
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+	               fwrite(entries, sizeof(pc_entry), kept, file) == kept;
+	if (fclose(file) || !written || rename(temporary, path)) {
+		return 0;
+	}
+	return kept;
+}
@@ -0,0 +1,85 @@
+#ifndef TT_CACHE_H
+#define TT_CACHE_H
+
+#include "tt_bot.h"
+#include "tt_types.h"
+
+/** Identifies a placement cache file ("TTPC"). */
+#define PC_MAGIC 0x54545043
+
+/** Height above the lowest column up to which columns are told apart in the contour of a board. */
+#define PC_MAX_STEP 3
+
+/**
+ * A cached decision: the key of a position and the placement a full search found for it.
+ */
+typedef struct {
+	uint64_t key;
+	uint8_t rotations;
+	uint8_t shift;
+	uint8_t padding[6];
+} pc_entry;
+
+/**
+ * Layout of a placement cache file: the header followed by count entries, sorted by key.
+ */
+typedef struct {
+	uint32_t magic;
+	uint32_t count;
+	pc_entry entries[];
+} pc_file;
+
+/**
+ * A placement cache mapped read only into memory, with the lookups it answered and missed.
+ */
+typedef struct {
+	const pc_file *file;
+	size_t size;
+	unsigned long long hits;
+	unsigned long long misses;
+} pc_cache;
+
+/**
+ * Computes the key of the decision the current block of a game stands for. It combines the width
+ * of the board, the contour of the stack, the current and the next block. The contour is given
+ * by the heights of the columns above the lowest one, capped at PC_MAX_STEP, so positions that
+ * only differ further down the stack share their key.
+ * @param tetris
+ * @return
+ */
+uint64_t pc_key(const tt_tetris *tetris);
+
+/**
+ * Maps a placement cache file.
+ * @param cache
+ * @param path
+ * @return false if the file is missing or no placement cache.
+ */
+bool pc_open(pc_cache *cache, const char *path);
+
+/**
+ * Unmaps a placement cache file.
+ * @param cache
+ */
+void pc_close(pc_cache *cache);
+
+/**
+ * Looks up the placement of the current block of a game and counts the hit or miss.
+ * @param cache
+ * @param tetris
+ * @param move set to the cached placement on a hit.
+ * @return false on a miss.
+ */
+bool pc_lookup(pc_cache *cache, const tt_tetris *tetris, bt_move *move);
+
+/**
+ * Writes decisions to a placement cache file. Decisions taken more than once keep the placement
+ * chosen most often. The entries are sorted in place and the file is replaced at once.
+ * @param path
+ * @param entries
+ * @param count
+ * @return the number of entries written, 0 if the file could not be written.
+ */
+uint32_t pc_write(const char *path, pc_entry *entries, uint32_t count);
+
+#endif // TT_CACHE_H
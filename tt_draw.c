@@ -1,5 +1,8 @@
 #include "tt_types.h"
+#include "tt_anim.h"
 #include "tt_draw.h"
+#include "tt_perf.h"
+#include "tt_render.h"
 #include "tt_score.h"
 
 /**
@@ -37,7 +40,7 @@ static WINDOW *init_help_window(int pos_y, int pos_x, int size_y, int size_x) {
 	if (!help) {
 		return NULL;
 	}
-	char controls[9][2][16] = {
+	char controls[11][2][16] = {
 		{ "h", "Help" },
 		{ "q", "Quit" },
 		{ "+", "Increase speed" },
@@ -47,10 +50,12 @@ static WINDOW *init_help_window(int pos_y, int pos_x, int size_y, int size_x) {
 		{ "D-arrow", "Move down" },
 		{ "U-arrow", "Rotate" },
 		{ "Space", "Fall down" },
+		{ "p", "Perf overlay" },
+		{ "u", "Undo piece" },
 	};
 
 	box(help, 0, 0);
-	for (int i = 0; i < 9; ++i) {
+	for (int i = 0; i < 11; ++i) {
 		mvwprintw(help, SUB_WIN_Y / 6 + i, SUB_WIN_X / 6, "%7s -- %s", controls[i][0],
 		          controls[i][1]);
 	}
@@ -60,44 +65,37 @@ static WINDOW *init_help_window(int pos_y, int pos_x, int size_y, int size_x) {
 }
 
 /**
- * Function for building a help menu with ncurses.
+ * Fills the highscore window with the list currently stored.
+ * @param window
+ */
+static void draw_highscores(WINDOW *window) {
+	// read highscores from local file, a default list is created if there is none yet
+	highscore *highscores = read_highscores();
+
+	werase(window);
+	box(window, 0, 0);
+	for (int i = 0; i < 9; ++i) {
+		mvwprintw(window, SUB_WIN_Y / 6 + i, SUB_WIN_X / 6, "%d. %10s -- %u pts",i+1, highscores[i].name, highscores[i].score);
+	}
+	mvwprintw(window, 0, SUB_WIN_X / 2 - 7, "[ Highscores ]");
+	mvwaddstr(window, 5 * SUB_WIN_Y / 6, SUB_WIN_X / 6, "Press ENTER to go back!");
+}
+
+/**
+ * Function for building a highscore list with ncurses.
  * The returned windows has to be freed at the end of its life cycle
  * (dw_delete_windows).
  * @param pos_y
  * @param pos_x
  * @param size_y
  * @param size_x
- * @return a pointer to the initialized help menu.
+ * @return a pointer to the initialized highscore list.
  */
 static WINDOW *init_highscore_window(int pos_y, int pos_x, int size_y, int size_x) {
 	WINDOW *window = init_window(pos_y, pos_x, size_y, size_x);
-	if (!window) {
-		return NULL;
+	if (window) {
+		draw_highscores(window);
 	}
-	// read highscores from local file
-	highscore highscores[10];
-	FILE *file;
-
-	file = fopen("./highscores.txt", "rb");
-	if (file == NULL) {
-		// create new file, if no file exists
-		highscore default_list[10];
-		for (int i = 0; i < 10; i++) {
-			default_list[i] = (highscore){ "NA", 0 };
-		}
-		
-		file = fopen("./highscores.txt", "wb");
-		fwrite(default_list, sizeof(default_list), 1, file);
-		fclose(file);
-	}
-    fread(highscores, sizeof(highscores), 1, file);
-
-	box(window, 0, 0);
-	for (int i = 0; i < 9; ++i) {
-		mvwprintw(window, SUB_WIN_Y / 6 + i, SUB_WIN_X / 6, "%d. %10s -- %u pts",i+1, highscores[i].name, highscores[i].score);
-	}
-	mvwprintw(window, 0, SUB_WIN_X / 2 - 7, "[ Highscores ]");
-	mvwaddstr(window, 5 * SUB_WIN_Y / 6, SUB_WIN_X / 6, "Press ENTER to go back!");
 	return window;
 }
 
@@ -112,9 +110,41 @@ bool dw_init_windows(tt_tetris *tetris) {
 	tetris->w_help = init_help_window(SUB_WIN_Y, SUB_WIN_X, (MAIN_WIN_Y - SUB_WIN_Y) / 2, (MAIN_WIN_X - SUB_WIN_X) / 2);
 	tetris->w_highscore = init_highscore_window(SUB_WIN_Y, SUB_WIN_X, (MAIN_WIN_Y - SUB_WIN_Y) / 2, (MAIN_WIN_X - SUB_WIN_X) / 2);
 	tetris->w_game_over = init_window(SUB_WIN_Y, SUB_WIN_X, (MAIN_WIN_Y - SUB_WIN_Y) / 2, (MAIN_WIN_X - SUB_WIN_X) / 2);
-	tetris->w_game = init_window(MAIN_WIN_Y + 2, MAIN_WIN_X + 2, 0, 0);
+	int size_y, size_x;
+	dw_game_size(tetris->rows, tetris->cols, &size_y, &size_x);
+	tetris->w_game = init_window(size_y + 2, size_x + 2, 0, 0);
 	tetris->w_main = init_window(MAIN_WIN_Y + 2, MAIN_WIN_X + 2, 0, 0);
-	return tetris->w_help && tetris->w_game_over && tetris->w_game && tetris->w_main && tetris->w_highscore;
+	rd_curses *curses = malloc(sizeof(*curses));
+	if (curses) {
+		rd_init_curses(curses, tetris->w_game);
+	}
+	tetris->renderer = tetris->curses_renderer = (rd_renderer *)curses;
+	return tetris->w_help && tetris->w_game_over && tetris->w_game && tetris->w_main && tetris->w_highscore && curses;
+}
+
+/**
+ * Returns how many columns a tile of the board is wide. Boards wider than 16 columns use a single
+ * column per tile, so they still fit next to the preview.
+ * @param cols width of the board.
+ * @return
+ */
+static int tile_width(int cols) {
+	return cols > 16 ? 1 : 2;
+}
+
+/**
+ * Returns the size of the game window needed for a board, without its border. It is at least
+ * MAIN_WIN_Y x MAIN_WIN_X and grows with the board, leaving room for the preview on the left and
+ * the perf overlay on the right.
+ * @param rows height of the board.
+ * @param cols width of the board.
+ * @param size_y
+ * @param size_x
+ */
+void dw_game_size(int rows, int cols, int *size_y, int *size_x) {
+	int board_width = tile_width(cols) * cols;
+	*size_y = rows + 10 > MAIN_WIN_Y ? rows + 10 : MAIN_WIN_Y;
+	*size_x = board_width + 58 > MAIN_WIN_X ? board_width + 58 : MAIN_WIN_X;
 }
 
 /**
@@ -123,7 +153,7 @@ bool dw_init_windows(tt_tetris *tetris) {
  * @param menuitem the currently selected item.
  */
 void dw_draw_main_menu(tt_tetris *tetris, cursor_main_menu menuitem) {
-	char menu[NUM_MAIN_MENU][11] = { "New Game", "High Score", "Help menu", "Quit" };
+	char menu[NUM_MAIN_MENU][11] = { "New Game", "Versus", "High Score", "Help menu", "Quit" };
 	werase(tetris->w_main);
 	box(tetris->w_main, 0, 0);
 	mvwprintw(tetris->w_main, 0, MAIN_WIN_X / 2 - 7, "[ Main Menu ]");
@@ -140,101 +170,311 @@ void dw_draw_main_menu(tt_tetris *tetris, cursor_main_menu menuitem) {
 }
 
 /**
- * Draws the game over window together with the score reached this round.
+ * Draws the game over window together with the score reached this round and updates the
+ * highscore window, which may list the score now.
  * @param tetris
  */
 void dw_draw_game_over(tt_tetris *tetris) {
-	// update scores
-	tetris->w_highscore = init_highscore_window(SUB_WIN_Y, SUB_WIN_X, (MAIN_WIN_Y - SUB_WIN_Y) / 2, (MAIN_WIN_X - SUB_WIN_X) / 2);
+	draw_highscores(tetris->w_highscore);
 	werase(tetris->w_game_over);
 	box(tetris->w_game_over, 0, 0);
 	mvwprintw(tetris->w_game_over, 0, SUB_WIN_X / 2 - 7, "[ Game Over ]");
 	mvwaddstr(tetris->w_game_over, 8, 3, "Press any key to restart!");
 	mvwprintw(tetris->w_game_over, 5, 3, "Score: %3d", tetris->score);
-	getchar();
 }
 
 /**
- * Draws the game window together with the board and the tetris block currently
- * falling.
+ * Draws the game over window asking for the name of a new highscore, with the name typed so far.
  * @param tetris
+ * @param name
  */
-void dw_draw_game_window(tt_tetris *tetris) {
-	werase(tetris->w_game);
-	box(tetris->w_game, 0, 0);
-	mvwprintw(tetris->w_game, 0, MAIN_WIN_X / 2 - 9, "[ Terminal-Tetris ]");
-	mvwprintw(tetris->w_game, MAIN_WIN_Y + 1, MAIN_WIN_X - 15, "[ Score: %3d ]", tetris->score);
+void dw_draw_name_entry(tt_tetris *tetris, const char *name) {
+	werase(tetris->w_game_over);
+	box(tetris->w_game_over, 0, 0);
+	mvwprintw(tetris->w_game_over, 0, SUB_WIN_X / 2 - 7, "[ Game Over ]");
+	mvwprintw(tetris->w_game_over, 5, 3, "Score: %3d", tetris->score);
+	mvwaddstr(tetris->w_game_over, 7, 3, "New highscore! Enter your name:");
+	mvwprintw(tetris->w_game_over, 8, 3, "> %s_", name);
+	mvwaddstr(tetris->w_game_over, 11, 3, "Press ENTER to save!");
+	touchwin(tetris->w_game_over);
+	wrefresh(tetris->w_game_over);
+}
 
-	int gameing_area_x = MAIN_WIN_X / 2 - BOARD_X + 2; // 31
-	int gameing_area_y = MAIN_WIN_Y / 6; // 5
-	
-	// draw board
-	for (int y = 0; y < BOARD_Y; y++) { // "<|| - - - - - - - - - - - ||>"
-		mvwprintw(tetris->w_game, y + gameing_area_y, gameing_area_x - 4, "<|| ");
-		mvwprintw(tetris->w_game, y + gameing_area_y, gameing_area_x + 21, " ||>");
-		for (int x = 0; x < BOARD_X; x++) {
+/**
+ * Draws the game over window of a versus match together with the winner and the garbage
+ * latency measured during the match.
+ * @param tetris
+ * @param match
+ */
+void dw_draw_versus_over(tt_tetris *tetris, vs_match *match) {
+	int winner = vs_winner(match);
+	werase(tetris->w_game_over);
+	box(tetris->w_game_over, 0, 0);
+	mvwprintw(tetris->w_game_over, 0, SUB_WIN_X / 2 - 7, "[ Game Over ]");
+	if (winner >= 0) {
+		mvwprintw(tetris->w_game_over, 3, 3, "Player %d wins!", winner + 1);
+	} else {
+		mvwprintw(tetris->w_game_over, 3, 3, "Nobody wins!");
+	}
+	mvwprintw(tetris->w_game_over, 5, 3, "Garbage events: %u", match->latency_count);
+	if (match->latency_count) {
+		mvwprintw(tetris->w_game_over, 6, 3, "Latency min: %lld us", match->latency_min_ns / 1000);
+		mvwprintw(tetris->w_game_over, 7, 3, "Latency avg: %lld us", match->latency_sum_ns / match->latency_count / 1000);
+		mvwprintw(tetris->w_game_over, 8, 3, "Latency max: %lld us", match->latency_max_ns / 1000);
+	}
+	if (match->dropped_events) {
+		mvwprintw(tetris->w_game_over, 9, 3, "Dropped events: %u", match->dropped_events);
+	}
+	mvwaddstr(tetris->w_game_over, 11, 3, "Press any key to continue!");
+}
+
+/**
+ * Draws the board of a game together with its borders and the block currently falling.
+ * The top left board tile is placed at [area_x, area_y], every tile is tile columns wide.
+ * While the rows of a line clear collapse, the rows above are drawn lifted and the cleared rows
+ * flash, as the animation timeline of the game says.
+ * @param renderer
+ * @param tetris
+ * @param area_y
+ * @param area_x
+ * @param tile width of a tile, 1 or 2 columns.
+ */
+static void draw_board(rd_renderer *renderer, tt_tetris *tetris, int area_y, int area_x, int tile) {
+	int right = area_x + tile * tetris->cols + (tile == 1);
+	const an_timeline *animation = tetris->animation;
+	for (int y = 0; y < tetris->rows; y++) { // "<|| - - - - - - - - - - - ||>"
+		renderer->put(renderer, y + area_y, area_x - 4, "<||", 0);
+		renderer->put(renderer, y + area_y, right, "||>", 0);
+		int shown = animation ? y - an_row_lift(animation, y) : y;
+		for (int x = 0; x < tetris->cols && shown >= 0; x++) {
 			if (tetris->board[y][x]) {
-				wattron(tetris->w_game, COLOR_PAIR(tetris->board[y][x]));
-				mvwprintw(tetris->w_game, gameing_area_y + y, gameing_area_x + x*2, "%c", CHAR_OCCUPIED);
-				wattroff(tetris->w_game, COLOR_PAIR(tetris->board[y][x]));
+				rd_printf(renderer, area_y + shown, area_x + x * tile, tetris->board[y][x], "%c", CHAR_OCCUPIED);
+			}
+		}
+	}
+	for (int y = 0; animation && y < tetris->rows; y++) {
+		bool flash = an_row_flashes(animation, y);
+		for (int x = 0; x < tetris->cols && flash; x++) {
+			rd_printf(renderer, area_y + y, area_x + x * tile, AN_FLASH_COLOR, "%c", CHAR_OCCUPIED);
+		}
+	}
+	renderer->put(renderer, tetris->rows + area_y, area_x - 4, "<||", 0);
+	renderer->put(renderer, tetris->rows + area_y, right, "||>", 0);
+	for (int x = 0; x < tetris->cols; x++) {
+		renderer->put(renderer, tetris->rows + area_y, area_x + x * tile, "=", 0);
+		renderer->put(renderer, tetris->rows + 1 + area_y, area_x + x * tile, "V", 0);
+	}
+
+	// draw current block to the board
+	for (int y = 0; y < tetris->current_block.width; ++y) {
+		for (int x = 0; x < tetris->current_block.width; ++x) {
+			int fx = tetris->current_block.x + x;
+			int fy = tetris->current_block.y + y;
+
+			if (tetris->current_block.array[y][x]) {
+				rd_printf(renderer, fy + area_y, tile * fx + area_x, tetris->current_block.color, "%c", CHAR_OCCUPIED);
 			}
 		}
 	}
-	mvwprintw(tetris->w_game, 20 + gameing_area_y, gameing_area_x - 4, "<|| = = = = = = = = = = = ||>");
-	mvwprintw(tetris->w_game, 21 + gameing_area_y, gameing_area_x, "V V V V V V V V V V V    ");
-	mvwprintw(tetris->w_game, 22 + gameing_area_y, gameing_area_x, "x: %d", tetris->current_block.x);
-	mvwprintw(tetris->w_game, 23 + gameing_area_y, gameing_area_x - 10, "y: %d", tetris->current_block.y);
-	mvwprintw(tetris->w_game, 24 + gameing_area_y, gameing_area_x - 10, "block_count: %d", tetris->block_count);
+}
+
+/**
+ * Draws the board like draw_board, but packs two rows into every cell using half blocks and makes
+ * every tile a single column wide. Cells without any occupied pixel are left empty.
+ * Line clear effects are applied to the pixels before they are packed.
+ * @param renderer
+ * @param tetris
+ * @param area_y
+ * @param area_x
+ */
+static void draw_board_halves(rd_renderer *renderer, tt_tetris *tetris, int area_y, int area_x) {
+	short pixels[BOARD_MAX_Y + 1][BOARD_MAX_X] = { { 0 } };
+	const an_timeline *animation = tetris->animation;
+	for (int y = 0; y < tetris->rows; y++) {
+		int shown = animation ? y - an_row_lift(animation, y) : y;
+		for (int x = 0; x < tetris->cols && shown >= 0; x++) {
+			pixels[shown][x] = tetris->board[y][x];
+		}
+	}
+	for (int y = 0; animation && y < tetris->rows; y++) {
+		bool flash = an_row_flashes(animation, y);
+		for (int x = 0; x < tetris->cols && flash; x++) {
+			pixels[y][x] = AN_FLASH_COLOR;
+		}
+	}
+	for (int y = 0; y < tetris->current_block.width; ++y) {
+		for (int x = 0; x < tetris->current_block.width; ++x) {
+			int fx = tetris->current_block.x + x;
+			int fy = tetris->current_block.y + y;
+			if (tetris->current_block.array[y][x] && fy >= 0 && fy < tetris->rows && fx >= 0 && fx < tetris->cols) {
+				pixels[fy][fx] = tetris->current_block.color;
+			}
+		}
+	}
+
+	int rows = (tetris->rows + 1) / 2;
+	for (int y = 0; y < rows; y++) {
+		renderer->put(renderer, area_y + y, area_x - 1, "|", 0);
+		renderer->put(renderer, area_y + y, area_x + tetris->cols, "|", 0);
+		for (int x = 0; x < tetris->cols; x++) {
+			short top = pixels[2 * y][x], bottom = pixels[2 * y + 1][x];
+			if (top || bottom) {
+				rd_put_halves(renderer, area_y + y, area_x + x, top, bottom);
+			}
+		}
+	}
+	for (int x = -1; x <= tetris->cols; x++) {
+		renderer->put(renderer, area_y + rows, area_x + x, "=", 0);
+	}
+}
+
+/**
+ * Draws the median and 99th percentile of all instrumentation counters next to the board.
+ * @param renderer
+ * @param perf
+ * @param area_y
+ * @param area_x
+ */
+static void draw_perf_overlay(rd_renderer *renderer, pf_stats *perf, int area_y, int area_x) {
+	char labels[PF_METRICS][8] = { "frame", "render", "key", "jitter", "bytes" };
+	renderer->put(renderer, area_y, area_x, "[ perf ]   p50    p99", 0);
+	for (int m = 0; m < PF_METRICS; m++) {
+		rd_printf(renderer, area_y + 1 + m, area_x, 0, "%-7s %6llu %6llu", labels[m],
+		          pf_percentile(&perf->histograms[m], 50), pf_percentile(&perf->histograms[m], 99));
+	}
+	rd_printf(renderer, area_y + 2 + PF_METRICS, area_x, 0, "sent: %llu bytes", perf->bytes_written);
+}
+
+/**
+ * Composes the game window with the board, the tetris block currently falling and the block
+ * preview through the given render backend.
+ * @param renderer
+ * @param tetris
+ */
+void dw_render_game(rd_renderer *renderer, tt_tetris *tetris) {
+	int size_y, size_x;
+	dw_game_size(tetris->rows, tetris->cols, &size_y, &size_x);
+	renderer->clear_frame(renderer);
+	renderer->draw_border(renderer);
+	renderer->put(renderer, 0, size_x / 2 - 9, "[ Terminal-Tetris ]", 0);
+	rd_printf(renderer, size_y + 1, size_x - 15, 0, "[ Score: %3d ]", tetris->score);
+	rd_printf(renderer, size_y + 1, size_x - 30, 0, "[ Level: %2u ]", tetris->level);
+
+	int tile = tile_width(tetris->cols), board_width = tile * tetris->cols;
+	int gameing_area_x = size_x / 2 - board_width / 2 + 2; // centres the board
+	int gameing_area_y = MAIN_WIN_Y / 6; // 5
+	if (renderer->half_blocks) {
+		draw_board_halves(renderer, tetris, gameing_area_y, gameing_area_x);
+	} else {
+		draw_board(renderer, tetris, gameing_area_y, gameing_area_x, tile);
+	}
+	// the points of recent clears float up next to the rows they were scored with
+	for (int i = 0; tetris->animation && i < tetris->animation->count; i++) {
+		const an_effect *effect = &tetris->animation->effects[i];
+		if (effect->kind != AN_SCORE_POP) {
+			continue;
+		}
+		int rise = (int)((tetris->animation->now - effect->start) * 3 / effect->duration);
+		int row = (renderer->half_blocks ? effect->first / 2 : effect->first) - rise;
+		rd_printf(renderer, gameing_area_y + (row > 0 ? row : 0), gameing_area_x + board_width + 5, 0, "+%u", effect->points);
+	}
+	rd_printf(renderer, tetris->rows + 2 + gameing_area_y, gameing_area_x, 0, "x: %d", tetris->current_block.x);
+	rd_printf(renderer, tetris->rows + 3 + gameing_area_y, gameing_area_x - 10, 0, "y: %d", tetris->current_block.y);
+	rd_printf(renderer, tetris->rows + 4 + gameing_area_y, gameing_area_x - 10, 0, "block_count: %d", tetris->block_count);
 	
 	// draw next block display borders
-	mvwprintw(tetris->w_game, gameing_area_y, gameing_area_x - 16, "=========");
-	mvwprintw(tetris->w_game, gameing_area_y + 5, gameing_area_x - 16, "=========");
+	renderer->put(renderer, gameing_area_y, gameing_area_x - 16, "=========", 0);
+	renderer->put(renderer, gameing_area_y + 5, gameing_area_x - 16, "=========", 0);
 
 	for (int i = 1; i < 5; i++) {
-		mvwprintw(tetris->w_game, gameing_area_y + i, gameing_area_x - 17, "|");
-		mvwprintw(tetris->w_game, gameing_area_y + i, gameing_area_x - 7, "|");
+		renderer->put(renderer, gameing_area_y + i, gameing_area_x - 17, "|", 0);
+		renderer->put(renderer, gameing_area_y + i, gameing_area_x - 7, "|", 0);
 	}
 	
 	// draw next block
-	wattron(tetris->w_game, COLOR_PAIR(tetris->next_block.color));
-	for (int i = 0; i < tetris->next_block.width; i++) {
+	for (int i = 0; renderer->half_blocks && i < tetris->next_block.width; i += 2) {
+		for (int j = 0; j < tetris->next_block.width; j++) {
+			short top = tetris->next_block.array[i][j] ? tetris->next_block.color : 0;
+			short bottom = tetris->next_block.array[i + 1][j] ? tetris->next_block.color : 0;
+			if (top || bottom) {
+				rd_put_halves(renderer, i / 2 + gameing_area_y + 1, gameing_area_x - 15 + j, top, bottom);
+			}
+		}
+	}
+	for (int i = 0; !renderer->half_blocks && i < tetris->next_block.width; i++) {
 		for (int j = 0; j < tetris->next_block.width; j++) {
 			if (tetris->next_block.array[i][j]) {
-				mvwprintw(tetris->w_game, i + gameing_area_y+1, gameing_area_x - 15 + j*2, "%c", CHAR_OCCUPIED);
+				rd_printf(renderer, i + gameing_area_y+1, gameing_area_x - 15 + j*2, tetris->next_block.color, "%c", CHAR_OCCUPIED);
 			}
 		}
 	}
-	wattroff(tetris->w_game, COLOR_PAIR(tetris->next_block.color));
 
-	// draw current block to the board
-	wattron(tetris->w_game, COLOR_PAIR(tetris->current_block.color));
-	for (int y = 0; y < tetris->current_block.width; ++y) {
-		for (int x = 0; x < tetris->current_block.width; ++x) {
-			int fx = tetris->current_block.x + x;
-			int fy = tetris->current_block.y + y;
+	if (tetris->perf && tetris->perf->overlay) {
+		draw_perf_overlay(renderer, tetris->perf, gameing_area_y, gameing_area_x + board_width + 5);
+	}
+	renderer->present(renderer);
+}
 
-			if (tetris->current_block.array[y][x]) {
-				mvwprintw(tetris->w_game, fy + gameing_area_y, 2 * fx + gameing_area_x, "%c ", CHAR_OCCUPIED);
-			}
+/**
+ * Draws the game window together with the board and the tetris block currently
+ * falling, using the render backend of the game.
+ * @param tetris
+ */
+void dw_draw_game_window(tt_tetris *tetris) {
+	dw_render_game(tetris->renderer, tetris);
+}
+
+/**
+ * Draws the boards of all players of a versus match next to each other. Two players get a half
+ * of the window each, more players share it with boards of single column tiles.
+ * Remote players are only listed with their state, their board lives in another process.
+ * @param tetris
+ * @param match
+ */
+void dw_draw_versus_window(tt_tetris *tetris, vs_match *match) {
+	static const char *const controls[VS_MAX_PLAYERS] = { "a d s w Tab", "arrows Space", "j l k i Enter", "4 6 5 8 0" };
+	rd_renderer *renderer = tetris->renderer;
+	renderer->clear_frame(renderer);
+	renderer->draw_border(renderer);
+	renderer->put(renderer, 0, MAIN_WIN_X / 2 - 6, "[ Versus ]", 0);
+
+	bool wide = match->count <= 2;
+	int area_y = MAIN_WIN_Y / 6, slot = wide ? MAIN_WIN_X / 2 - 2 : (MAIN_WIN_X - 4) / match->count;
+	for (int i = 0; i < match->count; i++) {
+		vs_player *player = &match->players[i];
+		int area_x = (wide ? 10 : 7) + i * slot;
+		rd_printf(renderer, area_y - 2, area_x, 0, "P%d%s", i + 1, player->is_over ? " - lost" : "");
+		if (player->is_remote) {
+			renderer->put(renderer, area_y, area_x, "remote opponent", 0);
+			continue;
+		}
+		draw_board(renderer, player->tetris, area_y, area_x, wide ? tile_width(player->tetris->cols) : 1);
+		if (wide) {
+			rd_printf(renderer, area_y - 1, area_x, 0, "lines: %u  incoming: %d", player->tetris->lines, player->pending_garbage);
+		} else {
+			rd_printf(renderer, area_y - 1, area_x - 4, 0, "%u lines +%d", player->tetris->lines, player->pending_garbage);
 		}
+		// the only local player of a match over the socket plays with the arrows
+		int keys = match->players[match->count - 1].is_remote ? 1 : i;
+		renderer->put(renderer, area_y + player->tetris->rows + 2, area_x - (wide ? 0 : 4), controls[keys], 0);
 	}
-	wattroff(tetris->w_game, COLOR_PAIR(tetris->current_block.color));
-	wrefresh(tetris->w_game);
-	refresh();
+	if (match->latency_count) {
+		rd_printf(renderer, MAIN_WIN_Y, 3, 0, "[ garbage latency: min %lld avg %lld max %lld us ]",
+		          match->latency_min_ns / 1000, match->latency_sum_ns / match->latency_count / 1000,
+		          match->latency_max_ns / 1000);
+	}
+	renderer->present(renderer);
 }
 
 /**
  * Function that acts similar to a popup in any browser.
- * It draws the window w_next over the current window.
- * As soon as any button has been pressed window w_next_next will be drawn.
- * @param tetris
+ * It draws the window over the current window and returns at once, the window stays till
+ * another one is drawn over it.
+ * @param window
  */
-void dw_show_static_window(WINDOW *w_next, WINDOW *w_next_next) {
-	touchwin(w_next);
-	wrefresh(w_next);
-	getchar();
-	touchwin(w_next_next);
-	wrefresh(w_next_next);
+void dw_show_window(WINDOW *window) {
+	touchwin(window);
+	wrefresh(window);
 }
 
 /**
@@ -248,5 +488,6 @@ void dw_delete_windows(tt_tetris *tetris) {
 	delwin(tetris->w_game_over);
 	delwin(tetris->w_game);
 	delwin(tetris->w_main);
+	free(tetris->curses_renderer);
 	endwin();
 }
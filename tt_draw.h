@@ -1,10 +1,12 @@
 #ifndef TT_DRAW_H
 #define TT_DRAW_H
 
+#include "tt_render.h"
 #include "tt_types.h"
+#include "tt_versus.h"
 
 /** Defines the number of main menu items available to be selected. */
-#define NUM_MAIN_MENU 4
+#define NUM_MAIN_MENU 5
 
 /** Defines the total height of program window to be rendered in the back. */
 #define MAIN_WIN_Y 30
@@ -28,6 +30,17 @@
  */
 bool dw_init_windows(tt_tetris *tetris);
 
+/**
+ * Returns the size of the game window needed for a board, without its border. It is at least
+ * MAIN_WIN_Y x MAIN_WIN_X and grows with the board, leaving room for the preview on the left and
+ * the perf overlay on the right.
+ * @param rows height of the board.
+ * @param cols width of the board.
+ * @param size_y
+ * @param size_x
+ */
+void dw_game_size(int rows, int cols, int *size_y, int *size_x);
+
 /**
  * Draws the game menu together with the cursor on the currently selected item.
  * @param tetris
@@ -36,24 +49,56 @@ bool dw_init_windows(tt_tetris *tetris);
 void dw_draw_main_menu(tt_tetris *tetris, cursor_main_menu menuitem);
 
 /**
- * Draws the game over window together with the score reached this round.
+ * Draws the game over window together with the score reached this round and updates the
+ * highscore window, which may list the score now.
  * @param tetris
  */
 void dw_draw_game_over(tt_tetris *tetris);
 
 /**
- * Draws the game window together with the board and the tetris block currently falling.
+ * Draws the game over window asking for the name of a new highscore, with the name typed so far.
+ * @param tetris
+ * @param name
+ */
+void dw_draw_name_entry(tt_tetris *tetris, const char *name);
+
+/**
+ * Composes the game window with the board, the tetris block currently falling and the block
+ * preview through the given render backend.
+ * @param renderer
+ * @param tetris
+ */
+void dw_render_game(rd_renderer *renderer, tt_tetris *tetris);
+
+/**
+ * Draws the game window together with the board and the tetris block currently falling, using
+ * the render backend of the game.
  * @param tetris
  */
 void dw_draw_game_window(tt_tetris *tetris);
 
 /**
- * Function that acts similar to a popup in any browser.
- * It draws the window w_next over the current window.
- * As soon as any button has been pressed window w_next_next will be drawn.
+ * Draws the boards of all local players of a versus match next to each other.
+ * @param tetris
+ * @param match
+ */
+void dw_draw_versus_window(tt_tetris *tetris, vs_match *match);
+
+/**
+ * Draws the game over window of a versus match together with the winner and the garbage
+ * latency measured during the match.
  * @param tetris
+ * @param match
+ */
+void dw_draw_versus_over(tt_tetris *tetris, vs_match *match);
+
+/**
+ * Function that acts similar to a popup in any browser.
+ * It draws the window over the current window and returns at once, the window stays till
+ * another one is drawn over it.
+ * @param window
  */
-void dw_show_static_window(WINDOW *w_next, WINDOW *w_next_next);
+void dw_show_window(WINDOW *window);
 
 /**
  * Frees all windows from memory and restores the normal terminal settings, previously manipulated
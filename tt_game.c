@@ -1,6 +1,6 @@
+#include "tt_board.h"
 #include "tt_game.h"
 #include "tt_types.h"
-#include "tt_score.h"
 
 /**
  * Adds the currently falling block to the board.
@@ -8,28 +8,73 @@
  * @param tetris
  */
 static void add_block_to_board(tt_tetris *tetris) {
-	tetris_block block = tetris->current_block;
-	int len = block.width;
-	for (int i = 0; i < len; i++) {
-		for (int j = 0; j < len; j++) {
-			if (block.array[i][j]) {
-				// block.color is a nr between 1 and 7, which is true,
-				// so it still works like before, where 1 got assigned for full tiles.
-				tetris->board[block.y + i][block.x + j] = block.color;
-			}
-		}
-	}
+	tetris->last_locked = tetris->current_block;
+	tetris->kernels->place(tetris, &tetris->current_block);
 }
 
 /**
  * Moves the current block to its initial starting position from which it starts falling.
  * @param tetris
  */
-static void reset_block(tt_tetris *tetris) {
-	tetris->current_block.x = (BOARD_X - tetris->current_block.width) / 2;
+void gm_reset_block(tt_tetris *tetris) {
+	tetris->current_block.x = (tetris->cols - tetris->current_block.width) / 2;
 	tetris->current_block.y = 0;
 }
 
+/**
+ * Returns one of the seven tetrominoes in its spawn orientation.
+ * @param type index between 0 and 6, in the order of the color pairs O, J, L, T, I, S, Z.
+ * @return
+ */
+tetris_block gm_block(int type) {
+	static const tetris_block blocks[] = {
+		{ 2, 0, 0, {{ 1, 1 }, { 1, 1 }}, O_BLOCK },
+		{ 3, 0, 0, {{ 1, 0, 0 }, { 1, 1, 1 }, { 0, 0, 0 }}, J_BLOCK },
+		{ 3, 0, 0, {{ 0, 0, 1 }, { 1, 1, 1 }, { 0, 0, 0 }}, L_BLOCK },
+		{ 3, 0, 0, {{ 0, 1, 0 }, { 1, 1, 1 }, { 0, 0, 0 }}, T_BLOCK },
+		{ 4, 0, 0, {{ 0, 0, 0, 0 }, { 1, 1, 1, 1 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }}, I_BLOCK },
+		{ 3, 0, 0, {{ 0, 1, 1 }, { 1, 1, 0 }, { 0, 0, 0 }}, S_BLOCK },
+		{ 3, 0, 0, {{ 1, 1, 0 }, { 0, 1, 1 }, { 0, 0, 0 }}, Z_BLOCK }
+	};
+	return blocks[type];
+}
+
+/** Number of levels in the gravity table, higher levels keep the gravity of the last one. */
+#define GRAVITY_LEVELS 20
+
+/**
+ * Rows a block falls per tick for every level, as 16.16 fixed point. The curve starts at one row
+ * per second and ends at 20G. Boards may be taller than 20 rows, so at 20G try_tick pulls the
+ * block down the whole board and it reaches the stack in the tick it spawns on any board.
+ */
+static const uint32_t gravity_table[GRAVITY_LEVELS] = {
+	1092, 1377, 1768, 2311, 3075, 4169, 5759, 8107, 11634, 17026,
+	25416, 38709, 60169, 95483, 154742, 256187, 433425, 749597, 1310720, 1310720
+};
+
+/**
+ * Advances a xorshift32 random generator.
+ * @param state of the generator, never 0.
+ * @return the next random number.
+ */
+uint32_t gm_xorshift(uint32_t *state) {
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return *state = x;
+}
+
+/**
+ * Advances the random generator of the game (xorshift32).
+ * Every game carries its own generator state, so games seeded alike receive the same blocks.
+ * @param tetris
+ * @return the next random number.
+ */
+uint32_t gm_random(tt_tetris *tetris) {
+	return gm_xorshift(&tetris->rng);
+}
+
 /**
  * Creates a new randomly selected block for the block preview (next_block),
  * while the currently shown block becomes the new block, which to be controlled by the player
@@ -37,20 +82,12 @@ static void reset_block(tt_tetris *tetris) {
  * @param tetris
  */
 static void new_block(tt_tetris *tetris) {
-	tetris_block blocks[] = { 
-		(tetris_block){ 2, 0, 0, {{ 1, 1 }, { 1, 1 }}, O_BLOCK },
-		(tetris_block){ 3, 0, 0, {{ 1, 0, 0 }, { 1, 1, 1 }, { 0, 0, 0 }}, J_BLOCK },
-		(tetris_block){ 3, 0, 0, {{ 0, 0, 1 }, { 1, 1, 1 }, { 0, 0, 0 }}, L_BLOCK },
-		(tetris_block){ 3, 0, 0, {{ 0, 1, 0 }, { 1, 1, 1 }, { 0, 0, 0 }}, T_BLOCK },
-		(tetris_block){ 4, 0, 0, {{ 0, 0, 0, 0 }, { 1, 1, 1, 1 }, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }}, I_BLOCK },
-		(tetris_block){ 3, 0, 0, {{ 0, 1, 1 }, { 1, 1, 0 }, { 0, 0, 0 }}, S_BLOCK },
-		(tetris_block){ 3, 0, 0, {{ 1, 1, 0 }, { 0, 1, 1 }, { 0, 0, 0 }}, Z_BLOCK }
-	};
-	int rnd = rand() % 7;
+	int rnd = gm_random(tetris) % 7;
 	tetris->current_block = tetris->next_block;
-	reset_block(tetris);
-	tetris->next_block = blocks[rnd]; // 4
-	tetris->speed *= .95; // increase game speed with each new block
+	gm_reset_block(tetris);
+	tetris->next_block = gm_block(rnd);
+	tetris->lock_ticks = 0;
+	tetris->lock_resets = 0;
 	++tetris->block_count;
 }
 
@@ -69,121 +106,67 @@ tetris_block rotate_block(tetris_block block) {
 	return block;
 } 
 
-/**
- * Helper function that returns true, if any tile of the given block's bounding box 
- * is not in the game area. Takes offset to adjust which tile or to test a move.
- * bounding box: square, that contains the tetromino
- * @param block
- * @param x_offset
- * @param y_offset
- */
-bool is_out_of_bounds(tetris_block block, int x_offset, int y_offset) {
-	return (
-		block.y + y_offset < 0 ||
-		block.x + x_offset < 0 ||
-		block.y + y_offset >= BOARD_Y ||
-		block.x + x_offset >= BOARD_X
-	);
-}
-
 /**
  * Before any movement of a block is allowed, collision detection has to be performed.
  * Therefore the new block position, which is calculated by the current position plus the offset
  * [x_move, y_move] given, has to be checked for overlaps with possible occupied pixels.
  * Returns true, if the current block would collide with any other block or any bound.
+ * The check runs on the row words of the board, using the kernel of its width class.
  * @param tetris
+ * @param block
  * @param x_move
  * @param y_move
- * @param rotation
  * @return
- */ 
-bool would_collide(tetris_block block, char board[BOARD_Y][BOARD_X], int x_move, int y_move) {
-	int len = block.width;
-	// loops through all tiles of a block
-	for (int i = 0; i < len; i++) {
-		for (int j = 0; j < len; j++) {
-			// checks all tiles of the board where the block would land and 
-			// the corresponding tile of the block. if both are 1 => collision
-			if (block.array[j][i] && board[block.y + y_move + j][block.x + x_move + i]) return true;
-			// or if corresponding tiles are 1 and out of bounds => collision
-			if (block.array[j][i] && is_out_of_bounds(block, x_move + i, y_move + j)) return true;
-		}
-	}
-	return false;
+ */
+bool would_collide(const tt_tetris *tetris, tetris_block block, int x_move, int y_move) {
+	return tetris->kernels->collides(tetris, &block, x_move, y_move);
 }
 
 static bool valid_move(tt_tetris *tetris, int x_move, int y_move, bool rotation) {
 	// if no moves, it is rotation => block needs to be rotated before checking collision
 	tetris_block block = rotation ? rotate_block(tetris->current_block) : tetris->current_block;
-	return !would_collide(block, tetris->board, x_move, y_move);
+	return !would_collide(tetris, block, x_move, y_move);
 }
 
 /**
- * Helper function that returns true, if the given row is full and to be cleared.
- * Argument row is the y coordinate of the current block.
+ * Function that clears full rows and, accumulates the number of rows cleared.
+ * Also applies a multiplier, if multiple rows are cleared simultaneously.
+ * Rows get cleared one by one and after each clear the rows above will be moved one tile down.
+ * A full row is found by comparing its word against a full one, no pixel is looked at.
  * @param tetris
- * @param row
  */
-bool is_row_full(tt_tetris *tetris, int row) {
-	for (int i = 0; i < BOARD_X; i++) {
-		if (!tetris->board[row][i]) return false;
-	}
-	return true;
+void delete_lines(tt_tetris *tetris) {
+	tetris_block block = tetris->current_block;
+	tetris->last_cleared = tetris->kernels->clear_rows(tetris, block.y, block.width);
+	unsigned row_count = __builtin_popcount(tetris->last_cleared);
+	tetris->score += (row_count * 10) * row_count;
+	tetris->lines += row_count;
 }
 
 /**
- * Function that actually clears a single row and moves the rows above down.
- * Argument row is the y coordinate of the current block.
+ * Adds the block to the board, clears the full rows and brings in the next block.
+ * Clearing lines may raise the level.
  * @param tetris
- * @param row
  */
-void clear_row_and_move_rows_above(tt_tetris *tetris, int row) {
-	for (int i = 0; i < BOARD_X; i++) {
-		for (int j = row; j >= 0; j--) {
-			// the second loop moves the blocks above down
-			// the top row will always be zero
-			tetris->board[j][i] = j ? tetris->board[j - 1][i] : 0;
-		}
-	}
-}
-
-// not in use
-void clear_row(tt_tetris *tetris, int row) {
-	for (int i = 0; i < BOARD_X; i++) {
-		tetris->board[row][i] = 0;
-	}
-}
-// not in use
-void move_rows_down(tt_tetris *tetris, unsigned row_count) {
-	int len = tetris->current_block.width;
-	int row = tetris->current_block.y + (len-1) < BOARD_Y ? tetris->current_block.y + (len-1) : 0;
-	for (int i = 0; i < BOARD_X; i++) {
-		for (int j = row; j >= 0; j--) {
-			// the second loop moves the blocks above down
-			// the top row will always be zero
-			tetris->board[j][i] = tetris->board[j - row_count][i] ? tetris->board[j - row_count][i] : 0;
-		}
+static void lock_block(tt_tetris *tetris) {
+	add_block_to_board(tetris);
+	delete_lines(tetris);
+	new_block(tetris);
+	if (tetris->lines / LINES_PER_LEVEL > tetris->level) {
+		tetris->level = tetris->lines / LINES_PER_LEVEL;
 	}
 }
 
 /**
- * Function that clears full rows and, accumulates the number of rows cleared.
- * Also applies a multiplier, if multiple rows are cleared simultaneously.
- * Rows get cleared one by one and after each clear the rows above will be moved one tile down.
- * Inefficient when multiple rows get cleared in one go. 
+ * Restarts the lock delay after the block has been moved or rotated, unless that has happened
+ * LOCK_RESETS times for this block already.
  * @param tetris
  */
-void delete_lines(tt_tetris *tetris) {
-	tetris_block block = tetris->current_block;
-	unsigned row_count = 0;
-	for (int row = block.y; row < block.y + block.width; row++) {
-		if (is_row_full(tetris, row)) {
-			clear_row_and_move_rows_above(tetris, row);
-			++row_count;
-		}
+static void restart_lock_delay(tt_tetris *tetris) {
+	if (tetris->lock_ticks && tetris->lock_resets < LOCK_RESETS) {
+		tetris->lock_ticks = 0;
+		++tetris->lock_resets;
 	}
-	// if (row_count) move_rows_down(tetris, row_count);
-	tetris->score += (row_count * 10) * row_count;
 }
 
 /**
@@ -194,26 +177,21 @@ void delete_lines(tt_tetris *tetris) {
  * @return
  */
 static bool try_vertical_move(tt_tetris *tetris, enum tt_movement move) {
-	bool valid = valid_move(tetris, 0, 1, false);
-	if (valid) {
-		++tetris->current_block.y;
-
-		// recursively implement the fall down mechanic
-		if (move == TT_FALL_DOWN) {
-			try_vertical_move(tetris, TT_FALL_DOWN);
-		}
-	} else {
-		add_block_to_board(tetris);
-		delete_lines(tetris);
-		new_block(tetris);
+	// the fall down mechanic drops the block in one go and locks it right away
+	int distance = move == TT_FALL_DOWN ? bd_drop_distance(tetris, &tetris->current_block, tetris->rows)
+	                                    : valid_move(tetris, 0, 1, false);
+	tetris->current_block.y += distance;
+	if (move == TT_FALL_DOWN || !distance) {
+		lock_block(tetris);
 	}
-	return valid;
+	return distance > 0;
 }
 static bool try_horizontal_move(tt_tetris *tetris, enum tt_movement move) {
 	int dir = move == TT_LEFT ? -1 : 1; // direction: left or right
 	bool valid = valid_move(tetris, dir, 0, false);
 	if (valid) {
 		tetris->current_block.x += dir;
+		restart_lock_delay(tetris);
 	}
 	return valid;
 }
@@ -226,6 +204,7 @@ static bool try_rotation(tt_tetris *tetris) {
 	bool right_is_valid = valid_move(tetris, 1, 0, true);
 	if (valid || left_is_valid || right_is_valid) {
 		tetris->current_block = rotate_block(tetris->current_block);
+		restart_lock_delay(tetris);
 	}
 	if (!valid && left_is_valid) {
 		tetris->current_block.x -= 1;
@@ -234,18 +213,91 @@ static bool try_rotation(tt_tetris *tetris) {
 	}
 	return valid || left_is_valid || right_is_valid;
 }
+/**
+ * Drops the level back to the one reached by the lines cleared, undoing any TT_LEVEL_UP.
+ * @param tetris
+ * @return
+ */
 static bool try_alter_time(tt_tetris *tetris) {
-	tetris->speed = 500000;
+	tetris->level = tetris->lines / LINES_PER_LEVEL;
+	return true;
+}
+
+/**
+ * Changes the level by one, within the levels of the gravity table.
+ * @param tetris
+ * @param move TT_LEVEL_UP or TT_LEVEL_DOWN.
+ * @return false if the level is already at the end of the table.
+ */
+static bool try_change_level(tt_tetris *tetris, enum tt_movement move) {
+	if (move == TT_LEVEL_UP ? tetris->level + 1 >= GRAVITY_LEVELS : tetris->level == 0) {
+		return false;
+	}
+	tetris->level += move == TT_LEVEL_UP ? 1 : -1;
 	return true;
 }
 
+/**
+ * Advances the game by one tick of TICK_US. The block falls by the gravity of the level, which
+ * is accumulated as fixed point, so it may move a part of a row per tick or many rows at once.
+ * However strong the gravity, the rows reached are found in a single drop distance query and the
+ * block moves there in one step. At 20G it falls as far as the board is tall. Once the block rests
+ * on the stack for LOCK_DELAY ticks it locks.
+ * @param tetris
+ * @return true if the block moved down.
+ */
+static bool try_tick(tt_tetris *tetris) {
+	uint32_t pull = gravity_table[tetris->level < GRAVITY_LEVELS ? tetris->level : GRAVITY_LEVELS - 1];
+	tetris->gravity += pull;
+	int rows = tetris->gravity >> 16;
+	tetris->gravity &= 0xffff;
+	if (pull == gravity_table[GRAVITY_LEVELS - 1] && rows < tetris->rows) {
+		rows = tetris->rows;
+	}
+
+	// one row further than the gravity pulls, to know whether the block lands this tick
+	int distance = bd_drop_distance(tetris, &tetris->current_block, rows + 1);
+	int fall = distance < rows ? distance : rows;
+	tetris->current_block.y += fall;
+	if (distance > rows) {
+		tetris->lock_ticks = 0;
+	} else if (++tetris->lock_ticks >= LOCK_DELAY) {
+		lock_block(tetris);
+	}
+	return fall > 0;
+}
 
 /**
- * Removes all occupied pixels of the board for a new / fresh game.
+ * Advances the game by a number of ticks, exactly like as many TT_TICK moves, but stops right
+ * after a block locked. Ticks in which the gravity does not add up to a row and the block cannot
+ * lock change nothing but the gravity and lock delay counters, so they are passed in one go and
+ * slow gravity costs about one tick per row fallen.
  * @param tetris
+ * @param ticks
+ * @return the ticks left after a block locked, 0 once all have passed.
  */
-static void clear_board(tt_tetris *tetris) {
-	memset(tetris->board, 0, sizeof(**tetris->board) * BOARD_Y * BOARD_X);
+unsigned gm_pass_ticks(tt_tetris *tetris, unsigned ticks) {
+	while (ticks) {
+		uint32_t pull = gravity_table[tetris->level < GRAVITY_LEVELS ? tetris->level : GRAVITY_LEVELS - 1];
+		// the block rests or falls the same in every tick before the gravity reaches a row
+		unsigned idle = (0xffff - tetris->gravity) / pull;
+		if (idle > ticks) idle = ticks;
+		if (idle) {
+			bool resting = !bd_drop_distance(tetris, &tetris->current_block, 1);
+			int left = LOCK_DELAY - 1 - tetris->lock_ticks;
+			if (resting && (int)idle > left) idle = left > 0 ? left : 0;
+			tetris->gravity += idle * pull;
+			tetris->lock_ticks = resting ? tetris->lock_ticks + (int)idle : 0;
+			ticks -= idle;
+		}
+		if (ticks) {
+			unsigned pieces = tetris->block_count;
+			try_tick(tetris);
+			--ticks;
+			if (tetris->block_count != pieces) break;
+		}
+	}
+	return ticks;
 }
 
 /**
@@ -256,9 +308,55 @@ static void clear_board(tt_tetris *tetris) {
  * @return a bool that is true if any game over condition is valid.
  */
 bool gm_is_game_over(tt_tetris *tetris) {
-	bool is_over = (tetris->current_block.y < 1) && !valid_move(tetris, 0, 1, false);
-	if (is_over) update_highscores(tetris->score);
-	return is_over;
+	return (tetris->current_block.y < 1) && !valid_move(tetris, 0, 1, false);
+}
+
+/**
+ * Pushes the whole board up and fills the bottom with garbage rows.
+ * Every garbage row is full except for the hole column, so it can be cleared again.
+ * If the falling block overlaps with the raised stack it is lifted as well.
+ * @param tetris
+ * @param lines number of garbage rows to insert.
+ * @param hole column that is left free in every garbage row.
+ * @return false if the stack has been pushed out of the top of the board.
+ */
+bool gm_add_garbage(tt_tetris *tetris, int lines, int hole) {
+	if (lines <= 0) {
+		return true;
+	}
+	if (lines > tetris->rows) {
+		lines = tetris->rows;
+	}
+	bool topped_out = false;
+	for (int y = 0; y < lines; y++) {
+		for (int x = 0; x < tetris->cols; x++) {
+			if (tetris->board[y][x]) topped_out = true;
+		}
+	}
+	memmove(tetris->board[0], tetris->board[lines], sizeof(tetris->board[0]) * (tetris->rows - lines));
+	for (int y = tetris->rows - lines; y < tetris->rows; y++) {
+		for (int x = 0; x < tetris->cols; x++) {
+			tetris->board[y][x] = x == hole ? 0 : GARBAGE_BLOCK;
+		}
+	}
+	bd_sync(tetris);
+	while (!valid_move(tetris, 0, 0, false)) {
+		if (tetris->current_block.y <= 0) return false;
+		--tetris->current_block.y;
+	}
+	return !topped_out;
+}
+
+/**
+ * Locks the given block into the board in place of the falling one, as if it had landed there.
+ * Full rows are cleared, the score and level updated and the next block brought in, exactly like
+ * a block locked during play.
+ * @param tetris
+ * @param block
+ */
+void gm_lock_block(tt_tetris *tetris, tetris_block block) {
+	tetris->current_block = block;
+	lock_block(tetris);
 }
 
 /**
@@ -275,6 +373,9 @@ void gm_move_block(tt_tetris *tetris, enum tt_movement move) {
 		case TT_ROTATE: try_rotation(tetris); break;
 		case TT_DOWN: try_vertical_move(tetris, TT_DOWN); break;
 		case TT_ALTER_TIME: try_alter_time(tetris); break;
+		case TT_TICK: try_tick(tetris); break;
+		case TT_LEVEL_UP: try_change_level(tetris, TT_LEVEL_UP); break;
+		case TT_LEVEL_DOWN: try_change_level(tetris, TT_LEVEL_DOWN); break;
 		default: break;
 	}
 }
@@ -285,20 +386,36 @@ void gm_move_block(tt_tetris *tetris, enum tt_movement move) {
  * @param tetris
  */
 void gm_reset_game(tt_tetris *tetris) {
-	tetris->speed = INIT_SPEED;
+	tetris->level = 0;
+	tetris->gravity = 0;
+	tetris->lock_ticks = 0;
+	tetris->lock_resets = 0;
 	tetris->score = 0;
+	tetris->lines = 0;
 	tetris->block_count = 0;
-	clear_board(tetris);
-	reset_block(tetris);
+	bd_clear(tetris);
+	gm_reset_block(tetris);
 }
 
 /**
  * Initializes the game with a new preview and falling block.
- * It also sets the initial falling speed of the block and performs preparation for the tetris
- * board.
+ * It also sets the initial level of the game and performs preparation for the tetris
+ * board, whose size has to be set with bd_resize before.
  * @param tetris
  */
 void gm_init_game(tt_tetris *tetris) {
+	gm_seed_game(tetris, (uint32_t)rand());
+}
+
+/**
+ * Restarts the random generator of the game with the given seed and draws a fresh preview and
+ * falling block from it. Games seeded with the same value receive the same sequence of blocks.
+ * The size of the board is kept, it has to be set with bd_resize before.
+ * @param tetris
+ * @param seed any value, zero is replaced since xorshift would get stuck on it.
+ */
+void gm_seed_game(tt_tetris *tetris, uint32_t seed) {
+	tetris->rng = seed ? seed : 0x9e3779b9;
 	new_block(tetris);
 	new_block(tetris);
 	gm_reset_game(tetris);
@@ -29,10 +29,100 @@ void gm_reset_game(tt_tetris *tetris);
 
 /**
  * Initializes the game with a new preview and falling block.
- * It also sets the initial falling speed of the block and performs preparation for the tetris
- * board.
+ * It also sets the initial level of the game and performs preparation for the tetris
+ * board, whose size has to be set with bd_resize before.
  * @param tetris
  */
 void gm_init_game(tt_tetris *tetris);
 
+/**
+ * Restarts the random generator of the game with the given seed and draws a fresh preview and
+ * falling block from it. Games seeded with the same value receive the same sequence of blocks.
+ * The size of the board is kept, it has to be set with bd_resize before.
+ * @param tetris
+ * @param seed
+ */
+void gm_seed_game(tt_tetris *tetris, uint32_t seed);
+
+/**
+ * Returns one of the seven tetrominoes in its spawn orientation.
+ * @param type index between 0 and 6, in the order of the color pairs O, J, L, T, I, S, Z.
+ * @return
+ */
+tetris_block gm_block(int type);
+
+/**
+ * Rotates a block by 90 degrees clockwise.
+ * @param block
+ * @return the rotated block.
+ */
+tetris_block rotate_block(tetris_block block);
+
+/**
+ * Returns true, if the given block moved by [x_move, y_move] would overlap with an occupied tile
+ * of the board or leave the board. Runs the collision kernel of the width class of the board.
+ * @param tetris
+ * @param block
+ * @param x_move
+ * @param y_move
+ * @return
+ */
+bool would_collide(const tt_tetris *tetris, tetris_block block, int x_move, int y_move);
+
+/**
+ * Clears the full rows covered by the current block, moves the rows above down and adds the
+ * points for the cleared rows to the score.
+ * @param tetris
+ */
+void delete_lines(tt_tetris *tetris);
+
+/**
+ * Advances a xorshift32 random generator.
+ * @param state of the generator, never 0.
+ * @return the next random number.
+ */
+uint32_t gm_xorshift(uint32_t *state);
+
+/**
+ * Advances the random generator of the game.
+ * @param tetris
+ * @return the next random number.
+ */
+uint32_t gm_random(tt_tetris *tetris);
+
+/**
+ * Advances the game by a number of ticks, exactly like as many TT_TICK moves, but stops right
+ * after a block locked. Ticks in which the gravity does not add up to a row and the block cannot
+ * lock change nothing but the gravity and lock delay counters, so they are passed in one go and
+ * slow gravity costs about one tick per row fallen.
+ * @param tetris
+ * @param ticks
+ * @return the ticks left after a block locked, 0 once all have passed.
+ */
+unsigned gm_pass_ticks(tt_tetris *tetris, unsigned ticks);
+
+/**
+ * Pushes the whole board up and fills the bottom with garbage rows.
+ * Every garbage row is full except for the hole column.
+ * @param tetris
+ * @param lines number of garbage rows to insert.
+ * @param hole column that is left free in every garbage row.
+ * @return false if the stack has been pushed out of the top of the board.
+ */
+bool gm_add_garbage(tt_tetris *tetris, int lines, int hole);
+
+/**
+ * Moves the current block to its initial starting position from which it starts falling.
+ * @param tetris
+ */
+void gm_reset_block(tt_tetris *tetris);
+
+/**
+ * Locks the given block into the board in place of the falling one, as if it had landed there.
+ * Full rows are cleared, the score and level updated and the next block brought in.
+ * @param tetris
+ * @param block
+ */
+void gm_lock_block(tt_tetris *tetris, tetris_block block);
+
 #endif // TT_GAME_H
@@ -0,0 +1,261 @@
+#define _DEFAULT_SOURCE
+
+#include <errno.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "tt_perf.h"
+
+/** Names and units of all metrics, in the order of enum pf_metric. */
+static const char *metric_names[PF_METRICS][2] = {
+	{ "frame_time", "us" },
+	{ "render_time", "us" },
+	{ "key_to_screen", "us" },
+	{ "gravity_jitter", "us" },
+	{ "frame_bytes", "bytes" },
+};
+
+/**
+ * Initializes all counters.
+ * @param perf
+ * @param dump_path file the statistics are written to by pf_dump, may be NULL.
+ */
+void pf_init(pf_stats *perf, const char *dump_path) {
+	memset(perf, 0, sizeof(*perf));
+	perf->dump_path = dump_path;
+}
+
+/**
+ * Relays everything curses writes into the pipe to the standard output and counts the bytes.
+ * Runs on its own thread, so curses never waits for the count.
+ * @param arg the statistics the bytes are added to.
+ * @return
+ */
+static void *relay_terminal(void *arg) {
+	pf_stats *perf = arg;
+	char buffer[4096];
+	ssize_t n;
+	while ((n = read(perf->pipe[0], buffer, sizeof(buffer))) > 0 || (n < 0 && errno == EINTR)) {
+		if (n < 0) {
+			continue;
+		}
+		__atomic_add_fetch(&perf->bytes_written, n, __ATOMIC_RELAXED);
+		for (ssize_t done = 0, w; done < n; done += w) {
+			w = write(STDOUT_FILENO, buffer + done, n - done);
+			if (w <= 0) break;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Curses takes the size and modes of the terminal from its output, which now is a pipe.
+ * So the size is passed on through the environment and the input is switched to unbuffered,
+ * silent mode here, just like cbreak and noecho would do.
+ * @param perf
+ */
+static void prepare_terminal(pf_stats *perf) {
+	struct winsize size;
+	char number[16];
+	if (!ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) && size.ws_row && size.ws_col) {
+		snprintf(number, sizeof(number), "%d", size.ws_row);
+		setenv("LINES", number, 0);
+		snprintf(number, sizeof(number), "%d", size.ws_col);
+		setenv("COLUMNS", number, 0);
+	}
+	perf->has_tty = !tcgetattr(STDIN_FILENO, &perf->tty);
+	if (perf->has_tty) {
+		struct termios mode = perf->tty;
+		mode.c_lflag &= ~(ICANON | ECHO);
+		mode.c_cc[VMIN] = 1;
+		mode.c_cc[VTIME] = 0;
+		tcsetattr(STDIN_FILENO, TCSANOW, &mode);
+	}
+}
+
+/**
+ * Returns a stream curses can write the terminal output to. Every byte written to it is counted
+ * by a relay thread before being passed on to the standard output. If the relay cannot be set up
+ * the standard output itself is returned and no bytes are counted.
+ * @param perf
+ * @return
+ */
+FILE *pf_terminal(pf_stats *perf) {
+	if (perf->terminal) {
+		return perf->terminal;
+	}
+	if (pipe(perf->pipe)) {
+		return stdout;
+	}
+	perf->terminal = fdopen(perf->pipe[1], "w");
+	if (!perf->terminal || pthread_create(&perf->relay, NULL, relay_terminal, perf)) {
+		if (perf->terminal) fclose(perf->terminal);
+		else close(perf->pipe[1]);
+		close(perf->pipe[0]);
+		perf->terminal = NULL;
+		return stdout;
+	}
+	prepare_terminal(perf);
+	return perf->terminal;
+}
+
+/**
+ * Flushes the terminal stream and waits until the relay has passed on all output.
+ * Has to be called after curses has been ended.
+ * @param perf
+ */
+void pf_close(pf_stats *perf) {
+	if (perf->terminal) {
+		fclose(perf->terminal);
+		pthread_join(perf->relay, NULL);
+		close(perf->pipe[0]);
+		perf->terminal = NULL;
+	}
+	if (perf->has_tty) {
+		tcsetattr(STDIN_FILENO, TCSANOW, &perf->tty);
+		perf->has_tty = false;
+	}
+}
+
+/**
+ * Counts all bytes written to the terminal so far, including those still waiting in the pipe.
+ * @param perf
+ * @return
+ */
+static unsigned long long bytes_written(pf_stats *perf) {
+	int pending = 0;
+	if (perf->terminal) {
+		ioctl(perf->pipe[0], FIONREAD, &pending);
+	}
+	return __atomic_load_n(&perf->bytes_written, __ATOMIC_RELAXED) + pending;
+}
+
+/**
+ * Reads the monotonic clock.
+ * @return the current time in microseconds.
+ */
+long long pf_now_us() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000LL + now.tv_nsec / 1000;
+}
+
+/**
+ * Adds a value to the histogram of a metric.
+ * @param perf
+ * @param metric
+ * @param value negative values are counted as zero.
+ */
+void pf_record(pf_stats *perf, enum pf_metric metric, long long value) {
+	pf_histogram *histogram = &perf->histograms[metric];
+	unsigned long long v = value < 0 ? 0 : value;
+	int bucket = 0;
+	while (bucket < PF_BUCKETS - 1 && v >> bucket) {
+		++bucket;
+	}
+	++histogram->buckets[bucket];
+	++histogram->count;
+	histogram->sum += v;
+	if (v > histogram->max) histogram->max = v;
+}
+
+/**
+ * Remembers that a key has been received. The first key not yet shown on screen is measured.
+ * @param perf
+ */
+void pf_key(pf_stats *perf) {
+	if (!perf->key_us) {
+		perf->key_us = pf_now_us();
+	}
+}
+
+/**
+ * Marks the start of rendering a frame and records the time since the previous frame.
+ * @param perf
+ */
+void pf_render_begin(pf_stats *perf) {
+	long long now = pf_now_us();
+	if (perf->frame_start_us) {
+		pf_record(perf, PF_FRAME_TIME, now - perf->frame_start_us);
+	}
+	perf->frame_start_us = now;
+	perf->render_start_us = now;
+	perf->frame_bytes = bytes_written(perf);
+}
+
+/**
+ * Marks the end of rendering a frame. Records the render time, the bytes written to the terminal
+ * and, if a key is waiting to be shown, the latency from the key to the screen.
+ * @param perf
+ */
+void pf_render_end(pf_stats *perf) {
+	long long now = pf_now_us();
+	pf_record(perf, PF_RENDER_TIME, now - perf->render_start_us);
+	pf_record(perf, PF_FRAME_BYTES, bytes_written(perf) - perf->frame_bytes);
+	if (perf->key_us) {
+		pf_record(perf, PF_KEY_LATENCY, now - perf->key_us);
+		perf->key_us = 0;
+	}
+}
+
+/**
+ * Returns the name of a metric as used in the dump file.
+ * @param metric
+ * @return
+ */
+const char *pf_metric_name(enum pf_metric metric) {
+	return metric_names[metric][0];
+}
+
+/**
+ * Estimates a percentile of a histogram.
+ * @param histogram
+ * @param percentile between 0 and 100.
+ * @return the upper bound of the bucket holding the percentile.
+ */
+unsigned long long pf_percentile(const pf_histogram *histogram, double percentile) {
+	unsigned long long rank = histogram->count * percentile / 100, seen = 0;
+	for (int i = 0; i < PF_BUCKETS; i++) {
+		seen += histogram->buckets[i];
+		if (seen > rank) {
+			unsigned long long bound = i ? (1ULL << i) - 1 : 0;
+			return bound < histogram->max ? bound : histogram->max;
+		}
+	}
+	return histogram->max;
+}
+
+/**
+ * Writes all histograms to the dump file given to pf_init.
+ * Every metric gets a summary line followed by one line per non-empty bucket
+ * "bucket <metric> <lower bound> <upper bound> <count>".
+ * @param perf
+ * @return false if the file could not be written.
+ */
+bool pf_dump(pf_stats *perf) {
+	if (!perf->dump_path) {
+		return true;
+	}
+	FILE *file = fopen(perf->dump_path, "w");
+	if (!file) {
+		return false;
+	}
+	fprintf(file, "bytes_written %llu\n", bytes_written(perf));
+	for (int m = 0; m < PF_METRICS; m++) {
+		const pf_histogram *histogram = &perf->histograms[m];
+		fprintf(file, "metric %s unit %s count %llu mean %llu p50 %llu p90 %llu p99 %llu max %llu\n",
+		        metric_names[m][0], metric_names[m][1], histogram->count,
+		        histogram->count ? histogram->sum / histogram->count : 0,
+		        pf_percentile(histogram, 50), pf_percentile(histogram, 90),
+		        pf_percentile(histogram, 99), histogram->max);
+		for (int i = 0; i < PF_BUCKETS; i++) {
+			if (histogram->buckets[i]) {
+				fprintf(file, "bucket %s %llu %llu %llu\n", metric_names[m][0],
+				        i ? 1ULL << (i - 1) : 0, i ? (1ULL << i) - 1 : 0, histogram->buckets[i]);
+			}
+		}
+	}
+	return fclose(file) == 0;
+}
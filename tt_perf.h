@@ -0,0 +1,130 @@
+#ifndef TT_PERF_H
+#define TT_PERF_H
+
+#include <pthread.h>
+#include <stdio.h>
+#include <termios.h>
+
+#include "tt_types.h"
+
+/** Number of buckets of a histogram. Bucket i counts values in [2^(i-1), 2^i), bucket 0 zeros. */
+#define PF_BUCKETS 24
+
+/**
+ * Enum to list all measured quantities.
+ */
+enum pf_metric { PF_FRAME_TIME, PF_RENDER_TIME, PF_KEY_LATENCY, PF_GRAVITY_JITTER, PF_FRAME_BYTES, PF_METRICS };
+
+/**
+ * Histogram with fixed power-of-two buckets, so recording a value costs a few instructions.
+ */
+typedef struct {
+	unsigned long long count;
+	unsigned long long sum;
+	unsigned long long max;
+	unsigned long long buckets[PF_BUCKETS];
+} pf_histogram;
+
+/**
+ * Packs all counters of the built-in instrumentation.
+ * Times are taken from the monotonic clock in microseconds. The game only holds a pointer to this
+ * struct, which is NULL if instrumentation is disabled, so a disabled build pays one branch per
+ * frame.
+ */
+typedef struct pf_stats {
+	pf_histogram histograms[PF_METRICS];
+	unsigned long long bytes_written;
+	bool overlay;
+
+	long long frame_start_us;
+	long long render_start_us;
+	long long key_us;
+	unsigned long long frame_bytes;
+
+	FILE *terminal;
+	int pipe[2];
+	pthread_t relay;
+	struct termios tty;
+	bool has_tty;
+	const char *dump_path;
+} pf_stats;
+
+/**
+ * Initializes all counters.
+ * @param perf
+ * @param dump_path file the statistics are written to by pf_dump, may be NULL.
+ */
+void pf_init(pf_stats *perf, const char *dump_path);
+
+/**
+ * Returns a stream curses can write the terminal output to. Every byte written to it is counted
+ * by a relay thread before being passed on to the standard output. If the relay cannot be set up
+ * the standard output itself is returned and no bytes are counted.
+ * @param perf
+ * @return
+ */
+FILE *pf_terminal(pf_stats *perf);
+
+/**
+ * Flushes the terminal stream and waits until the relay has passed on all output.
+ * Has to be called after curses has been ended.
+ * @param perf
+ */
+void pf_close(pf_stats *perf);
+
+/**
+ * Reads the monotonic clock.
+ * @return the current time in microseconds.
+ */
+long long pf_now_us();
+
+/**
+ * Adds a value to the histogram of a metric.
+ * @param perf
+ * @param metric
+ * @param value
+ */
+void pf_record(pf_stats *perf, enum pf_metric metric, long long value);
+
+/**
+ * Remembers that a key has been received. The first key not yet shown on screen is measured.
+ * @param perf
+ */
+void pf_key(pf_stats *perf);
+
+/**
+ * Marks the start of rendering a frame and records the time since the previous frame.
+ * @param perf
+ */
+void pf_render_begin(pf_stats *perf);
+
+/**
+ * Marks the end of rendering a frame. Records the render time, the bytes written to the terminal
+ * and, if a key is waiting to be shown, the latency from the key to the screen.
+ * @param perf
+ */
+void pf_render_end(pf_stats *perf);
+
+/**
+ * Returns the name of a metric as used in the dump file.
+ * @param metric
+ * @return
+ */
+const char *pf_metric_name(enum pf_metric metric);
+
+/**
+ * Estimates a percentile of a histogram.
+ * @param histogram
+ * @param percentile between 0 and 100.
+ * @return the upper bound of the bucket holding the percentile.
+ */
+unsigned long long pf_percentile(const pf_histogram *histogram, double percentile);
+
+/**
+ * Writes all histograms to the dump file given to pf_init.
+ * @param perf
+ * @return false if the file could not be written.
+ */
+bool pf_dump(pf_stats *perf);
+
+#endif // TT_PERF_H
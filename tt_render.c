@@ -0,0 +1,166 @@
+#include <stdarg.h>
+
+#include "tt_render.h"
+
+static void curses_clear(rd_renderer *renderer) {
+	werase(((rd_curses *)renderer)->window);
+}
+
+static void curses_border(rd_renderer *renderer) {
+	box(((rd_curses *)renderer)->window, 0, 0);
+}
+
+static void curses_put(rd_renderer *renderer, int y, int x, const char *text, short color) {
+	WINDOW *window = ((rd_curses *)renderer)->window;
+	if (color) wattron(window, COLOR_PAIR(color));
+	mvwaddstr(window, y, x, text);
+	if (color) wattroff(window, COLOR_PAIR(color));
+}
+
+static void curses_present(rd_renderer *renderer) {
+	wrefresh(((rd_curses *)renderer)->window);
+	refresh();
+}
+
+/**
+ * Initializes a render backend for a curses window.
+ * @param curses
+ * @param window
+ */
+void rd_init_curses(rd_curses *curses, WINDOW *window) {
+	curses->base = (rd_renderer){ curses_clear, curses_border, curses_put, curses_present };
+	curses->window = window;
+}
+
+static void framebuffer_clear(rd_renderer *renderer) {
+	rd_framebuffer *framebuffer = (rd_framebuffer *)renderer;
+	for (int i = 0; i < framebuffer->rows * framebuffer->cols; i++) {
+		framebuffer->cells[i] = (rd_cell){ ' ', 0 };
+	}
+}
+
+static void framebuffer_put(rd_renderer *renderer, int y, int x, const char *text, short color) {
+	rd_framebuffer *framebuffer = (rd_framebuffer *)renderer;
+	if (y < 0 || y >= framebuffer->rows) {
+		return;
+	}
+	for (; *text && x < framebuffer->cols; text++, x++) {
+		if (x >= 0) {
+			*rd_cell_at(framebuffer, y, x) = (rd_cell){ *text, color };
+		}
+	}
+}
+
+static void framebuffer_border(rd_renderer *renderer) {
+	rd_framebuffer *framebuffer = (rd_framebuffer *)renderer;
+	int bottom = framebuffer->rows - 1, right = framebuffer->cols - 1;
+	for (int x = 1; x < right; x++) {
+		*rd_cell_at(framebuffer, 0, x) = (rd_cell){ '-', 0 };
+		*rd_cell_at(framebuffer, bottom, x) = (rd_cell){ '-', 0 };
+	}
+	for (int y = 1; y < bottom; y++) {
+		*rd_cell_at(framebuffer, y, 0) = (rd_cell){ '|', 0 };
+		*rd_cell_at(framebuffer, y, right) = (rd_cell){ '|', 0 };
+	}
+	framebuffer_put(renderer, 0, 0, "+", 0);
+	framebuffer_put(renderer, 0, right, "+", 0);
+	framebuffer_put(renderer, bottom, 0, "+", 0);
+	framebuffer_put(renderer, bottom, right, "+", 0);
+}
+
+static void framebuffer_present(rd_renderer *renderer) {
+	++((rd_framebuffer *)renderer)->frames;
+}
+
+/**
+ * Allocates a framebuffer with all cells empty.
+ * @param framebuffer
+ * @param rows
+ * @param cols
+ * @return false if the cells could not be allocated.
+ */
+bool rd_init_framebuffer(rd_framebuffer *framebuffer, int rows, int cols) {
+	framebuffer->base = (rd_renderer){ framebuffer_clear, framebuffer_border, framebuffer_put, framebuffer_present };
+	framebuffer->rows = rows;
+	framebuffer->cols = cols;
+	framebuffer->frames = 0;
+	framebuffer->cells = malloc(sizeof(*framebuffer->cells) * rows * cols);
+	if (!framebuffer->cells) {
+		return false;
+	}
+	framebuffer_clear(&framebuffer->base);
+	return true;
+}
+
+/**
+ * Frees the cells of a framebuffer.
+ * @param framebuffer
+ */
+void rd_destroy_framebuffer(rd_framebuffer *framebuffer) {
+	free(framebuffer->cells);
+	framebuffer->cells = NULL;
+}
+
+/**
+ * Returns the cell of a framebuffer at [x, y].
+ * @param framebuffer
+ * @param y
+ * @param x
+ * @return
+ */
+rd_cell *rd_cell_at(rd_framebuffer *framebuffer, int y, int x) {
+	return &framebuffer->cells[y * framebuffer->cols + x];
+}
+
+/**
+ * Writes formatted text at [x, y] in the given color pair.
+ * @param renderer
+ * @param y
+ * @param x
+ * @param color
+ * @param format printf-like format string.
+ */
+void rd_printf(rd_renderer *renderer, int y, int x, short color, const char *format, ...) {
+	char text[256];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(text, sizeof(text), format, args);
+	va_end(args);
+	renderer->put(renderer, y, x, text, color);
+}
+
+/**
+ * Writes a half block cell at [x, y], only for backends with half_blocks set.
+ * @param renderer
+ * @param y
+ * @param x
+ * @param top color pair of the upper pixel, 0 if empty.
+ * @param bottom color pair of the lower pixel, 0 if empty.
+ */
+void rd_put_halves(rd_renderer *renderer, int y, int x, short top, short bottom) {
+	const char text[] = { RD_HALF_BLOCK, '\0' };
+	renderer->put(renderer, y, x, text, top | bottom << 8);
+}
+
+/**
+ * Writes a framebuffer as plain text, e.g. for golden-frame snapshots. The characters come first,
+ * followed by the same grid with the color pair of every cell as a digit. Half blocks are written
+ * as '#' in the color of their top pixel.
+ * @param framebuffer
+ * @param file
+ */
+void rd_dump_framebuffer(rd_framebuffer *framebuffer, FILE *file) {
+	for (int y = 0; y < framebuffer->rows; y++) {
+		for (int x = 0; x < framebuffer->cols; x++) {
+			char ch = rd_cell_at(framebuffer, y, x)->ch;
+			fputc(ch == RD_HALF_BLOCK ? '#' : ch, file);
+		}
+		fputc('\n', file);
+	}
+	for (int y = 0; y < framebuffer->rows; y++) {
+		for (int x = 0; x < framebuffer->cols; x++) {
+			fputc('0' + (rd_cell_at(framebuffer, y, x)->color & 0xff) % 10, file);
+		}
+		fputc('\n', file);
+	}
+}
@@ -0,0 +1,117 @@
+#ifndef TT_RENDER_H
+#define TT_RENDER_H
+
+#include <stdio.h>
+
+#include "tt_types.h"
+
+/**
+ * Interface every render backend implements. The game window is composed through these four
+ * functions only, so it can be drawn to a terminal as well as into memory.
+ *  - clear_frame: empties the whole frame
+ *  - draw_border: draws a frame around the outermost cells
+ *  - put: writes text at [x, y] in the given color pair, 0 being the default colors
+ *  - present: shows the composed frame
+ *  - half_blocks: the backend shows RD_HALF_BLOCK cells, so the board can use two rows per cell
+ */
+typedef struct rd_renderer {
+	void (*clear_frame)(struct rd_renderer *renderer);
+	void (*draw_border)(struct rd_renderer *renderer);
+	void (*put)(struct rd_renderer *renderer, int y, int x, const char *text, short color);
+	void (*present)(struct rd_renderer *renderer);
+	bool half_blocks;
+} rd_renderer;
+
+/**
+ * Character of a cell showing two pixels on top of each other. Its color holds the color pair of
+ * the top pixel in the low byte and the one of the bottom pixel in the high byte, 0 being empty.
+ */
+#define RD_HALF_BLOCK '\x01'
+
+/**
+ * Render backend drawing into a curses window.
+ */
+typedef struct {
+	rd_renderer base;
+	WINDOW *window;
+} rd_curses;
+
+/**
+ * A single character cell of a framebuffer.
+ */
+typedef struct {
+	char ch;
+	short color;
+} rd_cell;
+
+/**
+ * Render backend drawing into a plain grid of cells in memory. Text outside of the grid is cut off.
+ */
+typedef struct {
+	rd_renderer base;
+	int rows, cols;
+	rd_cell *cells;
+	unsigned long long frames;
+} rd_framebuffer;
+
+/**
+ * Initializes a render backend for a curses window.
+ * @param curses
+ * @param window
+ */
+void rd_init_curses(rd_curses *curses, WINDOW *window);
+
+/**
+ * Allocates a framebuffer with all cells empty.
+ * @param framebuffer
+ * @param rows
+ * @param cols
+ * @return false if the cells could not be allocated.
+ */
+bool rd_init_framebuffer(rd_framebuffer *framebuffer, int rows, int cols);
+
+/**
+ * Frees the cells of a framebuffer.
+ * @param framebuffer
+ */
+void rd_destroy_framebuffer(rd_framebuffer *framebuffer);
+
+/**
+ * Returns the cell of a framebuffer at [x, y].
+ * @param framebuffer
+ * @param y
+ * @param x
+ * @return
+ */
+rd_cell *rd_cell_at(rd_framebuffer *framebuffer, int y, int x);
+
+/**
+ * Writes formatted text at [x, y] in the given color pair.
+ * @param renderer
+ * @param y
+ * @param x
+ * @param color
+ * @param format printf-like format string.
+ */
+void rd_printf(rd_renderer *renderer, int y, int x, short color, const char *format, ...);
+
+/**
+ * Writes a half block cell at [x, y], only for backends with half_blocks set.
+ * @param renderer
+ * @param y
+ * @param x
+ * @param top color pair of the upper pixel, 0 if empty.
+ * @param bottom color pair of the lower pixel, 0 if empty.
+ */
+void rd_put_halves(rd_renderer *renderer, int y, int x, short top, short bottom);
+
+/**
+ * Writes a framebuffer as plain text, e.g. for golden-frame snapshots. The characters come first,
+ * followed by the same grid with the color pair of every cell as a digit. Half blocks are written
+ * as '#' in the color of their top pixel.
+ * @param framebuffer
+ * @param file
+ */
+void rd_dump_framebuffer(rd_framebuffer *framebuffer, FILE *file);
+
+#endif // TT_RENDER_H
@@ -0,0 +1,316 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "tt_board.h"
+#include "tt_bot.h"
+#include "tt_game.h"
+#include "tt_replay.h"
+
+/**
+ * Writes all bytes of a buffer to a file.
+ * @param file
+ * @param data
+ * @param size
+ * @return false if the file could not take all of them.
+ */
+static bool write_all(int file, const void *data, size_t size) {
+	const unsigned char *bytes = data;
+	while (size) {
+		ssize_t written = write(file, bytes, size);
+		if (written <= 0) {
+			return false;
+		}
+		bytes += written;
+		size -= written;
+	}
+	return true;
+}
+
+/**
+ * Opens an archive to append games to. A new archive is created if the file does not exist.
+ * @param recorder
+ * @param path
+ * @return false if the file could not be opened or is no archive.
+ */
+bool rp_open(rp_recorder *recorder, const char *path) {
+	memset(recorder, 0, sizeof(*recorder));
+	recorder->file = open(path, O_RDWR | O_CREAT | O_APPEND, 0644);
+	if (recorder->file < 0) {
+		return false;
+	}
+	struct stat info;
+	rp_header header = { RP_MAGIC, RP_VERSION };
+	bool valid;
+	if (fstat(recorder->file, &info)) {
+		valid = false;
+	} else if (info.st_size == 0) {
+		valid = write_all(recorder->file, &header, sizeof(header));
+	} else {
+		rp_header existing;
+		valid = pread(recorder->file, &existing, sizeof(existing), 0) == sizeof(existing) &&
+		        existing.magic == header.magic && existing.version == header.version;
+	}
+	recorder->capacity = 4096;
+	recorder->buffer = malloc(recorder->capacity);
+	if (!valid || !recorder->buffer) {
+		close(recorder->file);
+		free(recorder->buffer);
+		recorder->buffer = NULL;
+		recorder->file = -1;
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Writes the game being recorded, if any, and closes the archive.
+ * @param recorder
+ * @param tetris the game being recorded.
+ */
+void rp_close(rp_recorder *recorder, const tt_tetris *tetris) {
+	if (recorder->file < 0) {
+		return;
+	}
+	rp_finish(recorder, tetris);
+	close(recorder->file);
+	free(recorder->buffer);
+	recorder->buffer = NULL;
+	recorder->file = -1;
+}
+
+/**
+ * Makes room for more bytes in the buffer of a recorder. If there is no memory left, the game
+ * being recorded is given up.
+ * @param recorder
+ * @param size number of bytes to be appended.
+ * @return false if the game has been given up.
+ */
+static bool reserve(rp_recorder *recorder, size_t size) {
+	if (recorder->length + size <= recorder->capacity) {
+		return true;
+	}
+	unsigned char *buffer = realloc(recorder->buffer, recorder->capacity * 2);
+	if (!buffer) {
+		recorder->length = 0;
+		return false;
+	}
+	recorder->buffer = buffer;
+	recorder->capacity *= 2;
+	return true;
+}
+
+/**
+ * Starts recording a game that has just been seeded. A game still being recorded is dropped,
+ * it has to be finished before the game is seeded again.
+ * @param recorder
+ * @param tetris
+ * @param seed the game has been started with.
+ */
+void rp_start(rp_recorder *recorder, const tt_tetris *tetris, uint32_t seed) {
+	recorder->game = (rp_game){ 0, 0, seed, 0, 0, (uint8_t)tetris->rows, (uint8_t)tetris->cols, { 0 } };
+	recorder->length = sizeof(rp_game);
+}
+
+/**
+ * Records an input of the game, after it has been fed to the game. Runs of game ticks are merged
+ * into a single byte.
+ * @param recorder
+ * @param move
+ */
+void rp_move(rp_recorder *recorder, enum tt_movement move) {
+	if (!recorder->length) {
+		return;
+	}
+	unsigned char *last = &recorder->buffer[recorder->length - 1];
+	if (move == TT_TICK && recorder->length > sizeof(rp_game) && *last >= RP_TICKS && *last < 0xff) {
+		++*last;
+	} else if (reserve(recorder, 1)) {
+		recorder->buffer[recorder->length++] = move == TT_TICK ? RP_TICKS : (unsigned char)move;
+	}
+}
+
+/**
+ * Appends the game being recorded to the archive. Games without any input are dropped.
+ * The game is written with a single call, so games of several recorders appending to the same
+ * archive do not interleave.
+ * @param recorder
+ * @param tetris the game at its end.
+ * @return false if the game could not be written.
+ */
+bool rp_finish(rp_recorder *recorder, const tt_tetris *tetris) {
+	if (recorder->length <= sizeof(rp_game)) {
+		recorder->length = 0;
+		return true;
+	}
+	if (!reserve(recorder, 7)) {
+		return false;
+	}
+	size_t length = recorder->length;
+	recorder->length = 0;
+	size_t size = (length + 7) & ~(size_t)7;
+	memset(recorder->buffer + length, 0, size - length);
+	recorder->game.size = (uint32_t)size;
+	recorder->game.moves = (uint32_t)(length - sizeof(rp_game));
+	recorder->game.score = tetris->score;
+	recorder->game.block_count = tetris->block_count;
+	memcpy(recorder->buffer, &recorder->game, sizeof(rp_game));
+	if (!write_all(recorder->file, recorder->buffer, size)) {
+		return false;
+	}
+	++recorder->games;
+	return true;
+}
+
+/**
+ * Maps an archive file.
+ * @param archive
+ * @param path
+ * @return false if the file is missing or no archive.
+ */
+bool rp_map(rp_archive *archive, const char *path) {
+	memset(archive, 0, sizeof(*archive));
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat info;
+	void *map = MAP_FAILED;
+	if (!fstat(fd, &info) && (size_t)info.st_size >= sizeof(rp_header)) {
+		map = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	}
+	close(fd);
+	if (map == MAP_FAILED) {
+		return false;
+	}
+	archive->data = map;
+	archive->size = info.st_size;
+	const rp_header *header = map;
+	if (header->magic != RP_MAGIC || header->version != RP_VERSION) {
+		rp_unmap(archive);
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Unmaps an archive file.
+ * @param archive
+ */
+void rp_unmap(rp_archive *archive) {
+	if (archive->data) {
+		munmap((void *)archive->data, archive->size);
+		archive->data = NULL;
+	}
+}
+
+/**
+ * Steps to the next game of an archive.
+ * @param archive
+ * @param offset position of the next game, starts at sizeof(rp_header) and is moved past the game.
+ * @return the game or NULL at the end of the archive or at a damaged game, e.g. one cut off by a
+ * crash while it was written.
+ */
+const rp_game *rp_next(const rp_archive *archive, size_t *offset) {
+	if (archive->size - *offset < sizeof(rp_game)) {
+		return NULL;
+	}
+	const rp_game *game = (const rp_game *)(archive->data + *offset);
+	if (game->size < sizeof(rp_game) || game->size % 8 || game->size > archive->size - *offset ||
+	    game->moves > game->size - sizeof(rp_game) || game->rows < BOARD_MIN_Y || game->rows > BOARD_MAX_Y ||
+	    game->cols < BOARD_MIN_X || game->cols > BOARD_MAX_X) {
+		return NULL;
+	}
+	*offset += game->size;
+	return game;
+}
+
+/**
+ * Adds a piece that has just locked to the statistics.
+ * @param tetris
+ * @param type block type of the piece.
+ * @param lines rows cleared by the piece.
+ * @param holes holes of the board before the piece, updated to those after it.
+ * @param stats
+ */
+static void count_piece(tt_tetris *tetris, int type, unsigned lines, int *holes, rp_stats *stats) {
+	int heights[BOARD_MAX_X];
+	int now = bt_heights(tetris, heights);
+	++stats->pieces;
+	++stats->placed[type];
+	++stats->clears[lines < 4 ? lines : 4];
+	if (now > *holes) {
+		stats->holes += now - *holes;
+	}
+	*holes = now;
+	unsigned point = tetris->block_count / RP_CURVE_STEP;
+	if (tetris->block_count % RP_CURVE_STEP == 0 && point <= RP_CURVE_POINTS) {
+		stats->curve_score[point - 1] += tetris->score;
+		++stats->curve_games[point - 1];
+	}
+}
+
+/**
+ * Replays a game without drawing it and adds what happened to the statistics.
+ * @param tetris game the replay runs on, only needs to be allocated.
+ * @param game
+ * @param stats
+ */
+void rp_replay(tt_tetris *tetris, const rp_game *game, rp_stats *stats) {
+	const unsigned char *moves = (const unsigned char *)(game + 1);
+	bd_resize(tetris, game->rows, game->cols);
+	gm_seed_game(tetris, game->seed);
+	int holes = 0;
+	for (uint32_t i = 0; i < game->moves; i++) {
+		// a run of ticks passes in one go up to every block it locks
+		unsigned ticks = moves[i] >= RP_TICKS ? moves[i] - RP_TICKS + 1 : 0;
+		stats->moves += ticks ? ticks : 1;
+		do {
+			unsigned pieces = tetris->block_count, lines = tetris->lines;
+			int type = tetris->current_block.color - 1;
+			if (ticks) ticks = gm_pass_ticks(tetris, ticks);
+			else gm_move_block(tetris, (enum tt_movement)moves[i]);
+			if (tetris->block_count != pieces) {
+				count_piece(tetris, type, tetris->lines - lines, &holes, stats);
+			}
+		} while (ticks);
+	}
+	++stats->games;
+	stats->lines += tetris->lines;
+	stats->score += tetris->score;
+	if (gm_is_game_over(tetris)) {
+		++stats->topped_out[tetris->current_block.color - 1];
+	}
+	if (tetris->score != game->score || tetris->block_count != game->block_count) {
+		++stats->mismatches;
+	}
+}
+
+/**
+ * Adds statistics to a total.
+ * @param total
+ * @param part
+ */
+void rp_merge(rp_stats *total, const rp_stats *part) {
+	total->games += part->games;
+	total->pieces += part->pieces;
+	total->moves += part->moves;
+	total->lines += part->lines;
+	total->score += part->score;
+	total->mismatches += part->mismatches;
+	total->holes += part->holes;
+	for (int i = 0; i < 5; i++) {
+		total->clears[i] += part->clears[i];
+	}
+	for (int i = 0; i < RP_TYPES; i++) {
+		total->placed[i] += part->placed[i];
+		total->topped_out[i] += part->topped_out[i];
+	}
+	for (int i = 0; i < RP_CURVE_POINTS; i++) {
+		total->curve_score[i] += part->curve_score[i];
+		total->curve_games[i] += part->curve_games[i];
+	}
+}
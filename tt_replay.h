@@ -0,0 +1,163 @@
+#ifndef TT_REPLAY_H
+#define TT_REPLAY_H
+
+#include "tt_types.h"
+
+/** Identifies a game archive file ("TTRP"). */
+#define RP_MAGIC 0x54545250
+
+/** Version of the layout of the games in an archive. */
+#define RP_VERSION 1
+
+/** Inputs are stored as one byte each, bytes from RP_TICKS on stand for 1 to 128 game ticks. */
+#define RP_TICKS 0x80
+
+/** The score curve holds the mean score after every RP_CURVE_STEP pieces. */
+#define RP_CURVE_STEP 100
+
+/** Number of points of the score curve. */
+#define RP_CURVE_POINTS 50
+
+/** Number of block types. */
+#define RP_TYPES 7
+
+/**
+ * Header of an archive file, followed by any number of games.
+ */
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+} rp_header;
+
+/**
+ * Header in front of every game of an archive, followed by its inputs. A game is given by the
+ * size of its board and the seed it was started with, everything else follows from replaying the
+ * inputs. Score and pieces at its end tell whether a replay still matches the game played.
+ * The size includes the header and is a multiple of 8 bytes.
+ */
+typedef struct {
+	uint32_t size;
+	uint32_t moves;
+	uint32_t seed;
+	uint32_t score;
+	uint32_t block_count;
+	uint8_t rows, cols;
+	uint8_t padding[2];
+} rp_game;
+
+/**
+ * Writer side of an archive. The inputs of the game being played are collected behind room for
+ * its header and appended to the file in one piece once the game is done.
+ */
+typedef struct {
+	int file;
+	unsigned char *buffer;
+	size_t length, capacity;
+	rp_game game;
+	unsigned long long games;
+} rp_recorder;
+
+/**
+ * An archive mapped read only into memory.
+ */
+typedef struct {
+	const unsigned char *data;
+	size_t size;
+} rp_archive;
+
+/**
+ * Statistics over replayed games. All counters only add up, so statistics of parts of an
+ * archive can be merged in any order.
+ *  - clears: locked pieces by the rows they cleared
+ *  - holes: holes formed, counted as the growth of the holes of the board with every piece
+ *  - placed and topped_out: locked pieces and game overs by block type
+ *  - curve_score and curve_games: summed score of the games still running after every
+ *    RP_CURVE_STEP pieces and the number of them
+ *  - mismatches: games whose replay does not end with the score and pieces recorded
+ */
+typedef struct {
+	unsigned long long games, pieces, moves, lines, score, mismatches;
+	unsigned long long clears[5];
+	unsigned long long holes;
+	unsigned long long placed[RP_TYPES], topped_out[RP_TYPES];
+	unsigned long long curve_score[RP_CURVE_POINTS], curve_games[RP_CURVE_POINTS];
+} rp_stats;
+
+/**
+ * Opens an archive to append games to. A new archive is created if the file does not exist.
+ * @param recorder
+ * @param path
+ * @return false if the file could not be opened or is no archive.
+ */
+bool rp_open(rp_recorder *recorder, const char *path);
+
+/**
+ * Writes the game being recorded, if any, and closes the archive.
+ * @param recorder
+ * @param tetris the game being recorded.
+ */
+void rp_close(rp_recorder *recorder, const tt_tetris *tetris);
+
+/**
+ * Starts recording a game that has just been seeded. A game still being recorded is dropped,
+ * it has to be finished before the game is seeded again.
+ * @param recorder
+ * @param tetris
+ * @param seed the game has been started with.
+ */
+void rp_start(rp_recorder *recorder, const tt_tetris *tetris, uint32_t seed);
+
+/**
+ * Records an input of the game, after it has been fed to the game.
+ * @param recorder
+ * @param move
+ */
+void rp_move(rp_recorder *recorder, enum tt_movement move);
+
+/**
+ * Appends the game being recorded to the archive. Games without any input are dropped.
+ * @param recorder
+ * @param tetris the game at its end.
+ * @return false if the game could not be written.
+ */
+bool rp_finish(rp_recorder *recorder, const tt_tetris *tetris);
+
+/**
+ * Maps an archive file.
+ * @param archive
+ * @param path
+ * @return false if the file is missing or no archive.
+ */
+bool rp_map(rp_archive *archive, const char *path);
+
+/**
+ * Unmaps an archive file.
+ * @param archive
+ */
+void rp_unmap(rp_archive *archive);
+
+/**
+ * Steps to the next game of an archive.
+ * @param archive
+ * @param offset position of the next game, starts at sizeof(rp_header) and is moved past the game.
+ * @return the game or NULL at the end of the archive or at a damaged game, e.g. one cut off by a
+ * crash while it was written.
+ */
+const rp_game *rp_next(const rp_archive *archive, size_t *offset);
+
+/**
+ * Replays a game without drawing it and adds what happened to the statistics.
+ * @param tetris game the replay runs on, only needs to be allocated.
+ * @param game
+ * @param stats
+ */
+void rp_replay(tt_tetris *tetris, const rp_game *game, rp_stats *stats);
+
+/**
+ * Adds statistics to a total.
+ * @param total
+ * @param part
+ */
+void rp_merge(rp_stats *total, const rp_stats *part);
+
+#endif // TT_REPLAY_H
@@ -0,0 +1,171 @@
+#include "tt_board.h"
+#include "tt_game.h"
+#include "tt_rewind.h"
+
+/**
+ * Allocates a history for games on a board of the given size.
+ * The capacity is rounded up to whole keyframe intervals, plus one for the keyframe that is
+ * being filled with deltas.
+ * @param history
+ * @param pieces number of pieces that can be stepped back at least.
+ * @param rows height of the board.
+ * @param cols width of the board.
+ * @return false if the allocation failed.
+ */
+bool rw_init(rw_history *history, unsigned pieces, int rows, int cols) {
+	memset(history, 0, sizeof(*history));
+	history->keyframe_count = (pieces + RW_INTERVAL - 1) / RW_INTERVAL + 1;
+	history->capacity = history->keyframe_count * RW_INTERVAL;
+	history->rows = rows;
+	history->cols = cols;
+	history->deltas = malloc(history->capacity * sizeof(rw_delta));
+	history->keyframes = malloc(history->keyframe_count * sizeof(rw_keyframe));
+	history->boards = malloc((size_t)history->keyframe_count * rows * cols);
+	return history->deltas && history->keyframes && history->boards;
+}
+
+/**
+ * Frees the memory of a history.
+ * @param history
+ */
+void rw_destroy(rw_history *history) {
+	free(history->deltas);
+	free(history->keyframes);
+	free(history->boards);
+	memset(history, 0, sizeof(*history));
+}
+
+/**
+ * Keeps the current state of the game as keyframe of a piece.
+ * @param history
+ * @param tetris
+ * @param piece multiple of RW_INTERVAL.
+ */
+static void save_keyframe(rw_history *history, const tt_tetris *tetris, unsigned piece) {
+	unsigned slot = piece / RW_INTERVAL % history->keyframe_count;
+	rw_keyframe *keyframe = &history->keyframes[slot];
+	keyframe->current_block = tetris->current_block;
+	keyframe->next_block = tetris->next_block;
+	keyframe->score = tetris->score;
+	keyframe->lines = tetris->lines;
+	keyframe->level = tetris->level;
+	keyframe->block_count = tetris->block_count;
+	keyframe->rng = tetris->rng;
+	char *board = history->boards + (size_t)slot * history->rows * history->cols;
+	for (int y = 0; y < history->rows; y++) {
+		memcpy(board + y * history->cols, tetris->board[y], history->cols);
+	}
+}
+
+/**
+ * Puts the game back to the keyframe of a piece, with its block at the spawn position.
+ * @param history
+ * @param tetris
+ * @param piece multiple of RW_INTERVAL.
+ */
+static void load_keyframe(const rw_history *history, tt_tetris *tetris, unsigned piece) {
+	unsigned slot = piece / RW_INTERVAL % history->keyframe_count;
+	const rw_keyframe *keyframe = &history->keyframes[slot];
+	tetris->current_block = keyframe->current_block;
+	gm_reset_block(tetris);
+	tetris->next_block = keyframe->next_block;
+	tetris->score = keyframe->score;
+	tetris->lines = keyframe->lines;
+	tetris->level = keyframe->level;
+	tetris->block_count = keyframe->block_count;
+	tetris->rng = keyframe->rng;
+	tetris->last_cleared = 0;
+	tetris->gravity = 0;
+	tetris->lock_ticks = 0;
+	tetris->lock_resets = 0;
+	const char *board = history->boards + (size_t)slot * history->rows * history->cols;
+	for (int y = 0; y < history->rows; y++) {
+		memcpy(tetris->board[y], board + y * history->cols, history->cols);
+	}
+	bd_sync(tetris);
+}
+
+/**
+ * Forgets all pieces and keeps the current state of the game as the first one.
+ * Games on a board of another size than the history was made for are not recorded.
+ * @param history
+ * @param tetris
+ */
+void rw_restart(rw_history *history, const tt_tetris *tetris) {
+	history->oldest = history->newest = 0;
+	history->block_count = tetris->block_count;
+	if (tetris->rows == history->rows && tetris->cols == history->cols) {
+		save_keyframe(history, tetris, 0);
+	}
+}
+
+/**
+ * Records the piece locked since the previous call, if any. Restarts the history if the game has
+ * changed in a way a delta cannot express, e.g. a new game.
+ * Every RW_INTERVAL-th piece the whole game is kept as keyframe, which drops the oldest keyframe
+ * and its deltas once the history is full.
+ * @param history
+ * @param tetris
+ */
+void rw_record(rw_history *history, const tt_tetris *tetris) {
+	if (tetris->rows != history->rows || tetris->cols != history->cols ||
+	    tetris->block_count == history->block_count) {
+		return;
+	}
+	if (tetris->block_count != history->block_count + 1) {
+		rw_restart(history, tetris);
+		return;
+	}
+	unsigned piece = ++history->newest;
+	rw_delta *delta = &history->deltas[piece % history->capacity];
+	delta->locked = st_encode_piece(tetris->last_locked);
+	delta->level = tetris->level;
+	history->block_count = tetris->block_count;
+	if (piece % RW_INTERVAL == 0) {
+		save_keyframe(history, tetris, piece);
+		if (piece - history->oldest >= history->capacity) {
+			history->oldest = piece - history->capacity + RW_INTERVAL;
+		}
+	}
+}
+
+/**
+ * Puts the game back to the spawn of an earlier piece. The pieces after it are forgotten.
+ * The keyframe at or before the piece is restored and the blocks of the deltas up to the piece
+ * are locked again, which is at most RW_INTERVAL - 1 locks however far the game goes back.
+ * @param history
+ * @param tetris
+ * @param pieces number of pieces to go back.
+ * @return number of pieces gone back, less than asked for if the history is shorter.
+ */
+unsigned rw_step_back(rw_history *history, tt_tetris *tetris, unsigned pieces) {
+	if (pieces > history->newest - history->oldest) {
+		pieces = history->newest - history->oldest;
+	}
+	if (!pieces || tetris->rows != history->rows || tetris->cols != history->cols) {
+		return 0;
+	}
+	unsigned target = history->newest - pieces;
+	unsigned piece = target - target % RW_INTERVAL;
+	load_keyframe(history, tetris, piece);
+	while (piece++ < target) {
+		const rw_delta *delta = &history->deltas[piece % history->capacity];
+		gm_lock_block(tetris, st_decode_piece(delta->locked));
+		tetris->level = delta->level;
+	}
+	tetris->lock_ticks = 0;
+	tetris->lock_resets = 0;
+	history->newest = target;
+	history->block_count = tetris->block_count;
+	return pieces;
+}
+
+/**
+ * Returns the memory held by a history.
+ * @param history
+ * @return size in bytes.
+ */
+size_t rw_memory(const rw_history *history) {
+	return sizeof(*history) + history->capacity * sizeof(rw_delta) +
+	       history->keyframe_count * (sizeof(rw_keyframe) + (size_t)history->rows * history->cols);
+}
@@ -0,0 +1,101 @@
+#ifndef TT_REWIND_H
+#define TT_REWIND_H
+
+#include "tt_stream.h"
+#include "tt_types.h"
+
+/** A full keyframe of the game is kept every this many pieces, the pieces between are deltas. */
+#define RW_INTERVAL 64
+
+/** Number of pieces practice mode can step back. */
+#define RW_PIECES 10000
+
+/**
+ * What changed with a single piece: the block that locked and the level afterwards. Cleared rows,
+ * score, lines and the random generator follow from locking the block again.
+ */
+typedef struct {
+	st_piece locked;
+	uint16_t level;
+} rw_delta;
+
+/**
+ * Everything needed to restart the game at a piece, except for the board itself, which is kept
+ * in the board buffer of the history.
+ */
+typedef struct {
+	tetris_block current_block;
+	tetris_block next_block;
+	unsigned score;
+	unsigned lines;
+	unsigned level;
+	unsigned block_count;
+	uint32_t rng;
+} rw_keyframe;
+
+/**
+ * Bounded history of the pieces of a game, to step back to any of the last pieces.
+ * Pieces are numbered since the last restart. Piece n is kept as delta in slot n % capacity,
+ * every RW_INTERVAL-th piece also as keyframe in slot n / RW_INTERVAL % keyframe_count. Going
+ * back restores the keyframe at or before the piece and locks the blocks of the deltas up to it,
+ * so it never replays more than RW_INTERVAL pieces. Old keyframes are overwritten together with
+ * their deltas, the memory is allocated once.
+ */
+typedef struct rw_history {
+	rw_delta *deltas;
+	rw_keyframe *keyframes;
+	char *boards; // rows * cols pixels per keyframe
+	int rows, cols;
+	unsigned capacity, keyframe_count;
+	unsigned oldest, newest; // pieces that can be restored
+	unsigned block_count; // block count of the game at the newest piece
+} rw_history;
+
+/**
+ * Allocates a history for games on a board of the given size.
+ * @param history
+ * @param pieces number of pieces that can be stepped back at least.
+ * @param rows height of the board.
+ * @param cols width of the board.
+ * @return false if the allocation failed.
+ */
+bool rw_init(rw_history *history, unsigned pieces, int rows, int cols);
+
+/**
+ * Frees the memory of a history.
+ * @param history
+ */
+void rw_destroy(rw_history *history);
+
+/**
+ * Forgets all pieces and keeps the current state of the game as the first one.
+ * @param history
+ * @param tetris
+ */
+void rw_restart(rw_history *history, const tt_tetris *tetris);
+
+/**
+ * Records the piece locked since the previous call, if any. Restarts the history if the game has
+ * changed in a way a delta cannot express, e.g. a new game.
+ * @param history
+ * @param tetris
+ */
+void rw_record(rw_history *history, const tt_tetris *tetris);
+
+/**
+ * Puts the game back to the spawn of an earlier piece. The pieces after it are forgotten.
+ * @param history
+ * @param tetris
+ * @param pieces number of pieces to go back.
+ * @return number of pieces gone back, less than asked for if the history is shorter.
+ */
+unsigned rw_step_back(rw_history *history, tt_tetris *tetris, unsigned pieces);
+
+/**
+ * Returns the memory held by a history.
+ * @param history
+ * @return size in bytes.
+ */
+size_t rw_memory(const rw_history *history);
+
+#endif // TT_REWIND_H
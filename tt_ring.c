@@ -0,0 +1,69 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "tt_ring.h"
+
+/**
+ * Allocates the slots of a ring.
+ * @param ring
+ * @param capacity number of slots, has to be a power of two.
+ * @param slot_size size of a single item in bytes.
+ * @return false if the capacity is invalid or the allocation failed.
+ */
+bool rb_init(tt_ring *ring, unsigned capacity, size_t slot_size) {
+	memset(ring, 0, sizeof(*ring));
+	if (!capacity || (capacity & (capacity - 1))) {
+		return false;
+	}
+	ring->slots = malloc(capacity * slot_size);
+	if (!ring->slots) {
+		return false;
+	}
+	ring->mask = capacity - 1;
+	ring->slot_size = slot_size;
+	return true;
+}
+
+/**
+ * Frees the slots of a ring.
+ * @param ring
+ */
+void rb_destroy(tt_ring *ring) {
+	free(ring->slots);
+	ring->slots = NULL;
+}
+
+/**
+ * Copies an item into the ring. May only be called by the producer.
+ * The item is copied before the tail is published, so the consumer never sees a half written slot.
+ * @param ring
+ * @param item pointer to slot_size bytes.
+ * @return false if the ring is full.
+ */
+bool rb_push(tt_ring *ring, const void *item) {
+	unsigned tail = ring->tail;
+	unsigned head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+	if (tail - head > ring->mask) {
+		return false;
+	}
+	memcpy(ring->slots + (tail & ring->mask) * ring->slot_size, item, ring->slot_size);
+	__atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+/**
+ * Copies the oldest item out of the ring. May only be called by the consumer.
+ * @param ring
+ * @param item pointer to slot_size bytes the item is copied to.
+ * @return false if the ring is empty.
+ */
+bool rb_pop(tt_ring *ring, void *item) {
+	unsigned head = ring->head;
+	unsigned tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+	if (head == tail) {
+		return false;
+	}
+	memcpy(item, ring->slots + (head & ring->mask) * ring->slot_size, ring->slot_size);
+	__atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+	return true;
+}
@@ -0,0 +1,57 @@
+#ifndef TT_RING_H
+#define TT_RING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/** Assumed size of a cache line. Used to keep the producer and consumer index apart. */
+#define RB_CACHE_LINE 64
+
+/**
+ * Lock-free single-producer/single-consumer ring buffer of fixed-size slots.
+ * Exactly one thread may push and exactly one thread may pop at the same time.
+ * The producer only writes the tail, the consumer only writes the head, so neither side ever
+ * waits for the other one. A full ring rejects the push instead of blocking.
+ */
+typedef struct {
+	unsigned head; // next slot to be read, written by the consumer only
+	char pad_head[RB_CACHE_LINE - sizeof(unsigned)];
+	unsigned tail; // next slot to be written, written by the producer only
+	char pad_tail[RB_CACHE_LINE - sizeof(unsigned)];
+	unsigned mask;
+	size_t slot_size;
+	unsigned char *slots;
+} tt_ring;
+
+/**
+ * Allocates the slots of a ring.
+ * @param ring
+ * @param capacity number of slots, has to be a power of two.
+ * @param slot_size size of a single item in bytes.
+ * @return false if the capacity is invalid or the allocation failed.
+ */
+bool rb_init(tt_ring *ring, unsigned capacity, size_t slot_size);
+
+/**
+ * Frees the slots of a ring.
+ * @param ring
+ */
+void rb_destroy(tt_ring *ring);
+
+/**
+ * Copies an item into the ring. May only be called by the producer.
+ * @param ring
+ * @param item pointer to slot_size bytes.
+ * @return false if the ring is full.
+ */
+bool rb_push(tt_ring *ring, const void *item);
+
+/**
+ * Copies the oldest item out of the ring. May only be called by the consumer.
+ * @param ring
+ * @param item pointer to slot_size bytes the item is copied to.
+ * @return false if the ring is empty.
+ */
+bool rb_pop(tt_ring *ring, void *item);
+
+#endif // TT_RING_H
@@ -32,7 +32,6 @@ highscore *read_highscores() {
 	static highscore highscores[MAX];
 	FILE *file = fopen("./highscores.txt", "rb");
 	if (file == NULL) {
-		printf("No file found!\n");
 		return create_default_list();
 	}
     fread(highscores, sizeof(highscore), MAX, file);
@@ -40,36 +39,51 @@ highscore *read_highscores() {
 	return highscores;
 }
 
+/**
+ * Checks, if a given score is higher than a current highscore, so a name has to be asked for.
+ * @param score int
+ * @return
+ */
+bool is_highscore(int score) {
+	highscore *highscores = read_highscores();
+	for (int i = 0; i < MAX; i++) {
+		if (highscores[i].score < (unsigned)score) {
+			return true;
+		}
+	}
+	return false;
+}
+
 /**
  * Checks, if a given score is higher than a current highscore and
- * inserts it, if true.
+ * inserts it together with the name, if true.
  * @param score int
+ * @param name of the player, cut to the length a highscore can hold.
+ * @return false if the list could not be written.
  */
-void update_highscores(int score) {
+bool update_highscores(int score, const char *name) {
 	FILE *file;
 	highscore *highscores = read_highscores();
 
 	// traverse highscore list from highest to lowest score
 	for (int i = 0; i < MAX; i++) {
-		if (highscores[i].score < score) {
+		if (highscores[i].score < (unsigned)score) {
 			// move lower scores down down
 			for (int j = MAX-1; i < j; j--) {
 				highscores[j] = highscores[j-1];
 			}
 			// insert new score with a name into arr
 			highscores[i].score = score;
-			printf("Enter your name: ");
-			scanf("%s", highscores[i].name); // potential overflow?
+			snprintf(highscores[i].name, sizeof(highscores[i].name), "%s", name);
 
 			// write array to file
 			file = fopen("./highscores.txt", "wb");
 			if (file == NULL) {
-				printf("Error writing to file!\n");
-				exit(1);
+				return false;
 			}
 			fwrite(highscores, sizeof(highscore), MAX, file);
-			fclose(file);
-			break; // meh
+			return !fclose(file);
 		}
 	}
+	return true;
 }
\ No newline at end of file
@@ -8,13 +8,22 @@
  * it creates a default list by calling create_default_list();.
  * @return
  */
-struct highscore* read_highscores();
+highscore *read_highscores();
+
+/**
+ * Checks, if a given score is higher than a current highscore, so a name has to be asked for.
+ * @param score int
+ * @return
+ */
+bool is_highscore(int score);
 
 /**
  * Checks, if a given score is higher than a current highscore and
- * inserts it, if true.
+ * inserts it together with the name, if true.
  * @param score int
+ * @param name of the player, cut to the length a highscore can hold.
+ * @return false if the list could not be written.
  */
-void update_highscores(int score);
+bool update_highscores(int score, const char *name);
 
 #endif // TT_SCORE_H
@@ -0,0 +1,457 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "tt_board.h"
+#include "tt_stream.h"
+
+/** Upper bound of the size of any frame, which is reached by a keyframe. */
+#define MAX_FRAME ((sizeof(st_frame_header) + 2 * sizeof(st_piece) + 4 * sizeof(uint32_t) + 2 + \
+                    BOARD_MAX_Y * BOARD_MAX_X + 7) & ~(size_t)7)
+
+/**
+ * Writer may be ahead of the published position by a padding and a frame. Readers further behind
+ * than this might see their frame overwritten.
+ */
+#define MAX_LAG (ST_RING_SIZE - 2 * MAX_FRAME)
+
+/**
+ * Appends raw bytes to a frame under construction.
+ * @param cursor position in the frame, advanced by size.
+ * @param value
+ * @param size
+ */
+static void put(unsigned char **cursor, const void *value, size_t size) {
+	memcpy(*cursor, value, size);
+	*cursor += size;
+}
+
+/**
+ * Reads raw bytes of a frame.
+ * @param cursor position in the frame, advanced by size.
+ * @param value
+ * @param size
+ */
+static void get(const unsigned char **cursor, void *value, size_t size) {
+	memcpy(value, *cursor, size);
+	*cursor += size;
+}
+
+/**
+ * Packs the pose and shape of a block into its compact stream form.
+ * @param block
+ * @return
+ */
+st_piece st_encode_piece(tetris_block block) {
+	st_piece piece = { block.x, block.y, block.width, block.color, 0 };
+	for (int i = 0; i < 4 && i < block.width; i++) {
+		for (int j = 0; j < 4 && j < block.width; j++) {
+			if (block.array[i][j]) piece.shape |= 1u << (i * 4 + j);
+		}
+	}
+	return piece;
+}
+
+/**
+ * Unpacks a block from its compact stream form.
+ * @param piece
+ * @return
+ */
+tetris_block st_decode_piece(st_piece piece) {
+	tetris_block block;
+	memset(&block, 0, sizeof(block));
+	block.x = piece.x;
+	block.y = piece.y;
+	block.width = piece.width > 4 ? 4 : piece.width;
+	block.color = piece.color;
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 4; j++) {
+			block.array[i][j] = (piece.shape >> (i * 4 + j)) & 1;
+		}
+	}
+	return block;
+}
+
+/**
+ * Locks a block into the board of a view and removes the rows it cleared, top to bottom just like
+ * delete_lines does. Tiles outside of the board are ignored, so a damaged frame cannot write past
+ * the board.
+ * @param view
+ * @param block
+ * @param cleared bit i stands for row block.y + i.
+ */
+static void apply_lock(tt_tetris *view, tetris_block block, unsigned cleared) {
+	for (int i = 0; i < block.width; i++) {
+		for (int j = 0; j < block.width; j++) {
+			int y = block.y + i, x = block.x + j;
+			if (block.array[i][j] && y >= 0 && y < view->rows && x >= 0 && x < view->cols) {
+				view->board[y][x] = block.color;
+			}
+		}
+	}
+	for (int i = 0; i < 4; i++) {
+		int row = block.y + i;
+		if ((cleared >> i & 1) && row > 0 && row < view->rows) {
+			memmove(view->board[1], view->board[0], sizeof(view->board[0]) * row);
+			memset(view->board[0], 0, sizeof(view->board[0]));
+		}
+	}
+	bd_sync(view);
+	view->last_locked = block;
+	view->last_cleared = cleared;
+}
+
+/**
+ * Applies a keyframe or delta frame to a game. Writer and viewers share this function, so the
+ * shadow of the writer always equals what the viewers see.
+ * @param view
+ * @param frame
+ */
+static void apply_frame(tt_tetris *view, const unsigned char *frame) {
+	st_frame_header header;
+	st_piece piece;
+	uint32_t numbers[4];
+	const unsigned char *cursor = frame;
+	get(&cursor, &header, sizeof(header));
+
+	if (header.type == ST_KEYFRAME) {
+		unsigned char size[2];
+		get(&cursor, &piece, sizeof(piece));
+		view->current_block = st_decode_piece(piece);
+		get(&cursor, &piece, sizeof(piece));
+		view->next_block = st_decode_piece(piece);
+		get(&cursor, numbers, sizeof(numbers));
+		view->score = numbers[0];
+		view->lines = numbers[1];
+		view->block_count = numbers[2];
+		view->level = numbers[3];
+		get(&cursor, size, sizeof(size));
+		if ((size[0] == view->rows && size[1] == view->cols) || bd_resize(view, size[0], size[1])) {
+			for (int y = 0; y < view->rows; y++) {
+				get(&cursor, view->board[y], view->cols);
+			}
+			bd_sync(view);
+		}
+		return;
+	}
+	if (header.flags & ST_POSE) {
+		get(&cursor, &piece, sizeof(piece));
+		view->current_block = st_decode_piece(piece);
+	}
+	if (header.flags & ST_NEXT) {
+		get(&cursor, &piece, sizeof(piece));
+		view->next_block = st_decode_piece(piece);
+	}
+	if (header.flags & ST_LOCK) {
+		unsigned char cleared;
+		get(&cursor, &piece, sizeof(piece));
+		get(&cursor, &cleared, sizeof(cleared));
+		apply_lock(view, st_decode_piece(piece), cleared);
+	}
+	if (header.flags & ST_SCORE) {
+		get(&cursor, numbers, sizeof(numbers));
+		view->score = numbers[0];
+		view->lines = numbers[1];
+		view->block_count = numbers[2];
+		view->level = numbers[3];
+	}
+}
+
+/**
+ * Completes the header of a frame under construction.
+ * @param frame
+ * @param end
+ * @param type
+ * @param flags
+ * @return the size of the frame, padded to a multiple of 8 bytes.
+ */
+static size_t finish_frame(unsigned char *frame, unsigned char *end, int type, int flags) {
+	size_t size = (end - frame + 7) & ~(size_t)7;
+	memset(end, 0, frame + size - end);
+	st_frame_header header = { size, type, flags };
+	memcpy(frame, &header, sizeof(header));
+	return size;
+}
+
+/**
+ * Builds a keyframe holding the full board, both blocks and the score.
+ * @param frame
+ * @param tetris
+ * @return the size of the frame.
+ */
+static size_t build_keyframe(unsigned char *frame, tt_tetris *tetris) {
+	unsigned char *cursor = frame + sizeof(st_frame_header);
+	st_piece current = st_encode_piece(tetris->current_block);
+	st_piece next = st_encode_piece(tetris->next_block);
+	uint32_t numbers[4] = { tetris->score, tetris->lines, tetris->block_count, tetris->level };
+	unsigned char size[2] = { tetris->rows, tetris->cols };
+	put(&cursor, &current, sizeof(current));
+	put(&cursor, &next, sizeof(next));
+	put(&cursor, numbers, sizeof(numbers));
+	put(&cursor, size, sizeof(size));
+	for (int y = 0; y < tetris->rows; y++) {
+		put(&cursor, tetris->board[y], tetris->cols);
+	}
+	return finish_frame(frame, cursor, ST_KEYFRAME, 0);
+}
+
+/**
+ * Builds a delta frame from the differences between the shadow and the game.
+ * @param frame
+ * @param shadow what the viewers have seen so far.
+ * @param tetris
+ * @return the size of the frame, 0 if nothing changed or -1 if a keyframe is needed.
+ */
+static long build_delta(unsigned char *frame, tt_tetris *shadow, tt_tetris *tetris) {
+	unsigned char *cursor = frame + sizeof(st_frame_header);
+	int flags = 0;
+	st_piece current = st_encode_piece(tetris->current_block);
+	st_piece seen = st_encode_piece(shadow->current_block);
+	if (memcmp(&current, &seen, sizeof(current))) {
+		put(&cursor, &current, sizeof(current));
+		flags |= ST_POSE;
+	}
+	st_piece next = st_encode_piece(tetris->next_block);
+	seen = st_encode_piece(shadow->next_block);
+	if (memcmp(&next, &seen, sizeof(next))) {
+		put(&cursor, &next, sizeof(next));
+		flags |= ST_NEXT;
+	}
+	if (tetris->block_count != shadow->block_count) {
+		if (tetris->block_count != shadow->block_count + 1) {
+			return -1;
+		}
+		st_piece locked = st_encode_piece(tetris->last_locked);
+		unsigned char cleared = tetris->last_cleared;
+		put(&cursor, &locked, sizeof(locked));
+		put(&cursor, &cleared, sizeof(cleared));
+		flags |= ST_LOCK;
+	}
+	if (tetris->score != shadow->score || tetris->lines != shadow->lines ||
+	    tetris->block_count != shadow->block_count || tetris->level != shadow->level) {
+		uint32_t numbers[4] = { tetris->score, tetris->lines, tetris->block_count, tetris->level };
+		put(&cursor, numbers, sizeof(numbers));
+		flags |= ST_SCORE;
+	}
+	return flags ? (long)finish_frame(frame, cursor, ST_DELTA, flags) : 0;
+}
+
+/**
+ * Appends a frame to the shared ring. A frame never wraps around the end of the ring, the space
+ * left is covered by a padding frame instead, so viewers can decode every frame in place.
+ * @param ring
+ * @param frame
+ * @param size
+ */
+static void ring_append(st_ring *ring, const unsigned char *frame, size_t size) {
+	uint64_t pos = ring->write_pos;
+	size_t offset = pos & (ring->size - 1);
+	if (offset + size > ring->size) {
+		st_frame_header pad = { ring->size - offset, ST_PAD, 0 };
+		memcpy(ring->data + offset, &pad, sizeof(pad));
+		pos += pad.size;
+		offset = 0;
+	}
+	memcpy(ring->data + offset, frame, size);
+	__atomic_store_n(&ring->write_pos, pos + size, __ATOMIC_RELEASE);
+	if (((const st_frame_header *)frame)->type == ST_KEYFRAME) {
+		__atomic_store_n(&ring->keyframe_pos, pos, __ATOMIC_RELEASE);
+	}
+}
+
+/**
+ * Opens a spectator stream. Either path may be NULL.
+ * @param stream
+ * @param ring_path file that is mapped as shared ring for any number of viewers.
+ * @param file_path file, pipe or socket the frames are appended to.
+ * @return false if neither output could be opened.
+ */
+bool st_open(st_stream *stream, const char *ring_path, const char *file_path) {
+	memset(stream, 0, sizeof(*stream));
+	stream->file = -1;
+	stream->needs_keyframe = true;
+	if (ring_path) {
+		size_t length = sizeof(st_ring) + ST_RING_SIZE;
+		int fd = open(ring_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if (fd >= 0 && !ftruncate(fd, length)) {
+			void *map = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			if (map != MAP_FAILED) {
+				stream->ring = map;
+				stream->ring->size = ST_RING_SIZE;
+				__atomic_store_n(&stream->ring->magic, ST_MAGIC, __ATOMIC_RELEASE);
+			}
+		}
+		if (fd >= 0) close(fd);
+	}
+	if (file_path) {
+		stream->file = open(file_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	}
+	return stream->ring || stream->file >= 0;
+}
+
+/**
+ * Closes all outputs of a spectator stream.
+ * @param stream
+ */
+void st_close(st_stream *stream) {
+	if (stream->ring) {
+		munmap(stream->ring, sizeof(st_ring) + ST_RING_SIZE);
+		stream->ring = NULL;
+	}
+	if (stream->file >= 0) {
+		close(stream->file);
+		stream->file = -1;
+	}
+}
+
+/**
+ * Makes the next tick write a keyframe, e.g. because a new game has been started.
+ * @param stream
+ */
+void st_restart(st_stream *stream) {
+	stream->needs_keyframe = true;
+}
+
+/**
+ * Writes the changes of the game since the previous tick. Nothing is written if the game has not
+ * changed. Falls back to a keyframe if the game changed in a way a delta cannot express, e.g.
+ * when garbage rows came in.
+ * @param stream
+ * @param tetris
+ */
+void st_write_tick(st_stream *stream, tt_tetris *tetris) {
+	unsigned char frame[MAX_FRAME];
+	long size = 0;
+	if (stream->bytes - stream->keyframe_bytes > ST_KEYFRAME_DISTANCE) {
+		stream->needs_keyframe = true;
+	}
+	if (!stream->needs_keyframe) {
+		size = build_delta(frame, &stream->shadow, tetris);
+		if (size > 0) {
+			apply_frame(&stream->shadow, frame);
+		}
+		// garbage changes the board without any delta, so the board is compared even then
+		if (size >= 0 && (stream->shadow.rows != tetris->rows || stream->shadow.cols != tetris->cols ||
+		    memcmp(stream->shadow.board, tetris->board, sizeof(tetris->board[0]) * tetris->rows))) {
+			size = -1;
+		}
+	}
+	if (size < 0 || stream->needs_keyframe) {
+		size = build_keyframe(frame, tetris);
+		apply_frame(&stream->shadow, frame);
+		stream->needs_keyframe = false;
+		stream->keyframe_bytes = stream->bytes;
+	}
+	if (!size) {
+		return;
+	}
+	if (stream->ring) {
+		ring_append(stream->ring, frame, size);
+	}
+	if (stream->file >= 0 && write(stream->file, frame, size) != size) {
+		close(stream->file);
+		stream->file = -1;
+	}
+	++stream->frames;
+	stream->bytes += size;
+}
+
+/**
+ * Attaches a viewer to the shared ring of a stream. The viewer starts at the latest keyframe.
+ * @param reader
+ * @param path
+ * @return false if the file is no spectator ring.
+ */
+bool st_attach(st_reader *reader, const char *path) {
+	memset(reader, 0, sizeof(*reader));
+	size_t length = sizeof(st_ring) + ST_RING_SIZE;
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat info;
+	void *map = MAP_FAILED;
+	if (!fstat(fd, &info) && (size_t)info.st_size >= length) {
+		map = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+	}
+	close(fd);
+	if (map == MAP_FAILED) {
+		return false;
+	}
+	reader->ring = map;
+	if (__atomic_load_n(&reader->ring->magic, __ATOMIC_ACQUIRE) != ST_MAGIC ||
+	    reader->ring->size != ST_RING_SIZE) {
+		st_detach(reader);
+		return false;
+	}
+	reader->pos = __atomic_load_n(&reader->ring->keyframe_pos, __ATOMIC_ACQUIRE);
+	return true;
+}
+
+/**
+ * Detaches a viewer from its shared ring.
+ * @param reader
+ */
+void st_detach(st_reader *reader) {
+	if (reader->ring) {
+		munmap((void *)reader->ring, sizeof(st_ring) + ST_RING_SIZE);
+		reader->ring = NULL;
+	}
+}
+
+/**
+ * Checks that the writer cannot have overwritten the frame at the given position yet.
+ * @param reader
+ * @param pos
+ * @return
+ */
+static bool is_intact(st_reader *reader, uint64_t pos) {
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	return __atomic_load_n(&reader->ring->write_pos, __ATOMIC_ACQUIRE) - pos <= MAX_LAG;
+}
+
+/**
+ * Applies the next frame of the stream to the game of the viewer.
+ * A viewer that has been overtaken by the writer rejoins at the latest keyframe.
+ * @param reader
+ * @param view game that is reconstructed from the stream.
+ * @return false if no complete frame is available yet.
+ */
+bool st_read_frame(st_reader *reader, tt_tetris *view) {
+	const st_ring *ring = reader->ring;
+	while (__atomic_load_n(&ring->write_pos, __ATOMIC_ACQUIRE) != reader->pos) {
+		if (!is_intact(reader, reader->pos)) {
+			reader->pos = __atomic_load_n(&ring->keyframe_pos, __ATOMIC_ACQUIRE);
+			++reader->rejoins;
+			continue;
+		}
+		const unsigned char *frame = ring->data + (reader->pos & (ring->size - 1));
+		st_frame_header header;
+		memcpy(&header, frame, sizeof(header));
+		if (header.size < sizeof(header) || header.size > ring->size || header.size % 8) {
+			reader->pos = __atomic_load_n(&ring->keyframe_pos, __ATOMIC_ACQUIRE);
+			++reader->rejoins;
+			continue;
+		}
+		if (header.type == ST_PAD) {
+			reader->pos += header.size;
+			continue;
+		}
+		if (header.size > MAX_FRAME) {
+			reader->pos = __atomic_load_n(&ring->keyframe_pos, __ATOMIC_ACQUIRE);
+			++reader->rejoins;
+			continue;
+		}
+		apply_frame(view, frame);
+		if (!is_intact(reader, reader->pos)) {
+			// the frame was overwritten while it was read, the keyframe repairs the view
+			continue;
+		}
+		reader->pos += header.size;
+		return true;
+	}
+	return false;
+}
@@ -0,0 +1,147 @@
+#ifndef TT_STREAM_H
+#define TT_STREAM_H
+
+#include "tt_types.h"
+
+/** Size of the shared ring spectators read from. Has to be a power of two. */
+#define ST_RING_SIZE (1 << 16)
+
+/** A keyframe is written at least once every this many bytes, so new viewers can join quickly. */
+#define ST_KEYFRAME_DISTANCE (ST_RING_SIZE / 4)
+
+/** Identifies a file holding a spectator ring. */
+#define ST_MAGIC 0x54545354
+
+/**
+ * Enum to list all kinds of frames in a spectator stream.
+ * ST_PAD only occurs inside the shared ring and marks unused space before its end.
+ */
+enum st_frame_type { ST_KEYFRAME, ST_DELTA, ST_PAD };
+
+/**
+ * Flags of a delta frame, telling which fields follow the frame header.
+ */
+enum st_delta_flags { ST_POSE = 1, ST_NEXT = 2, ST_LOCK = 4, ST_SCORE = 8 };
+
+/**
+ * Header in front of every frame. The size includes the header and is a multiple of 8 bytes.
+ * All numbers are stored in the byte order of the machine, streams are meant for local screens.
+ */
+typedef struct {
+	uint32_t size;
+	uint16_t type;
+	uint16_t flags;
+} st_frame_header;
+
+/**
+ * Compact pose of a block: position, width, color and its shape as one bit per tile.
+ */
+typedef struct {
+	int8_t x, y;
+	uint8_t width, color;
+	uint16_t shape;
+} st_piece;
+
+/**
+ * Layout of the shared memory spectators attach to.
+ * Positions count all bytes ever written and only grow; the data offset is position % size.
+ */
+typedef struct {
+	uint32_t magic;
+	uint32_t size;
+	uint64_t write_pos;
+	uint64_t keyframe_pos;
+	unsigned char data[];
+} st_ring;
+
+/**
+ * Writer side of a spectator stream.
+ * The shadow holds exactly what a viewer has reconstructed from the stream so far, so every tick
+ * only the differences to the game have to be written.
+ */
+typedef struct st_stream {
+	st_ring *ring;
+	int file;
+	tt_tetris shadow;
+	bool needs_keyframe;
+	unsigned long long keyframe_bytes;
+	unsigned long long frames;
+	unsigned long long bytes;
+} st_stream;
+
+/**
+ * Reader side of a spectator stream. Frames are decoded straight out of the shared memory.
+ */
+typedef struct {
+	const st_ring *ring;
+	uint64_t pos;
+	unsigned long long rejoins;
+} st_reader;
+
+/**
+ * Opens a spectator stream. Either path may be NULL.
+ * @param stream
+ * @param ring_path file that is mapped as shared ring for any number of viewers.
+ * @param file_path file, pipe or socket the frames are appended to.
+ * @return false if neither output could be opened.
+ */
+bool st_open(st_stream *stream, const char *ring_path, const char *file_path);
+
+/**
+ * Closes all outputs of a spectator stream.
+ * @param stream
+ */
+void st_close(st_stream *stream);
+
+/**
+ * Writes the changes of the game since the previous tick. Nothing is written if the game has not
+ * changed. Falls back to a keyframe if the game changed in a way a delta cannot express.
+ * @param stream
+ * @param tetris
+ */
+void st_write_tick(st_stream *stream, tt_tetris *tetris);
+
+/**
+ * Makes the next tick write a keyframe, e.g. because a new game has been started.
+ * @param stream
+ */
+void st_restart(st_stream *stream);
+
+/**
+ * Attaches a viewer to the shared ring of a stream. The viewer starts at the latest keyframe.
+ * @param reader
+ * @param path
+ * @return false if the file is no spectator ring.
+ */
+bool st_attach(st_reader *reader, const char *path);
+
+/**
+ * Detaches a viewer from its shared ring.
+ * @param reader
+ */
+void st_detach(st_reader *reader);
+
+/**
+ * Applies the next frame of the stream to the game of the viewer.
+ * A viewer that has been overtaken by the writer rejoins at the latest keyframe.
+ * @param reader
+ * @param view game that is reconstructed from the stream.
+ * @return false if no complete frame is available yet.
+ */
+bool st_read_frame(st_reader *reader, tt_tetris *view);
+
+/**
+ * Packs the pose and shape of a block into its compact stream form.
+ * @param block
+ * @return
+ */
+st_piece st_encode_piece(tetris_block block);
+
+/**
+ * Unpacks a block from its compact stream form.
+ * @param piece
+ * @return
+ */
+tetris_block st_decode_piece(st_piece piece);
+
+#endif // TT_STREAM_H
@@ -0,0 +1,196 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <unistd.h>
+
+#include "tt_term.h"
+
+/** Worst case number of bytes needed to encode a single cell: cursor move, colors and glyph. */
+#define MAX_CELL_BYTES 32
+
+/** UTF-8 encoding of the upper half block, its foreground is the top, its background the bottom. */
+#define UPPER_HALF_BLOCK "\xe2\x96\x80"
+
+/**
+ * Maps a color pair to the ANSI foreground color used for it, -1 being the default color.
+ * The pairs are initialized in enable_color, mapping pair i to color i on black.
+ * @param color
+ * @return
+ */
+static int pair_fg(short color) {
+	if (color == GARBAGE_BLOCK) return COLOR_BLACK;
+	return color > 0 && color < 8 ? color : -1;
+}
+
+/**
+ * Maps a color pair to the ANSI background color used for it, -1 being the default color.
+ * @param color
+ * @return
+ */
+static int pair_bg(short color) {
+	return color == GARBAGE_BLOCK ? COLOR_WHITE : -1;
+}
+
+static void emit(tm_terminal *term, const char *bytes, size_t length) {
+	memcpy(term->out + term->out_len, bytes, length);
+	term->out_len += length;
+}
+
+/**
+ * Appends an SGR sequence, but only for colors that differ from the current ones.
+ * @param term
+ * @param fg
+ * @param bg
+ */
+static void emit_colors(tm_terminal *term, int fg, int bg) {
+	char sequence[24];
+	if (fg == term->fg && bg == term->bg) {
+		return;
+	}
+	int length;
+	if (fg != term->fg && bg != term->bg) {
+		length = snprintf(sequence, sizeof(sequence), "\x1b[%d;%dm", fg < 0 ? 39 : 30 + fg, bg < 0 ? 49 : 40 + bg);
+	} else if (fg != term->fg) {
+		length = snprintf(sequence, sizeof(sequence), "\x1b[%dm", fg < 0 ? 39 : 30 + fg);
+	} else {
+		length = snprintf(sequence, sizeof(sequence), "\x1b[%dm", bg < 0 ? 49 : 40 + bg);
+	}
+	emit(term, sequence, length);
+	term->fg = fg;
+	term->bg = bg;
+}
+
+/**
+ * Appends a single cell, moving the cursor there first unless it already is in place.
+ * @param term
+ * @param y
+ * @param x
+ * @param cell
+ */
+static void emit_cell(tm_terminal *term, int y, int x, rd_cell cell) {
+	if (y != term->cursor_y || x != term->cursor_x) {
+		char sequence[24];
+		int length = snprintf(sequence, sizeof(sequence), "\x1b[%d;%dH", y + 1, x + 1);
+		emit(term, sequence, length);
+	}
+	if (cell.ch == RD_HALF_BLOCK) {
+		int top = cell.color & 0xff, bottom = cell.color >> 8;
+		emit_colors(term, top ? pair_fg(top) : COLOR_BLACK, bottom ? pair_fg(bottom) : COLOR_BLACK);
+		emit(term, UPPER_HALF_BLOCK, sizeof(UPPER_HALF_BLOCK) - 1);
+	} else {
+		emit_colors(term, pair_fg(cell.color), pair_bg(cell.color));
+		emit(term, &cell.ch, 1);
+	}
+	term->cursor_y = y;
+	term->cursor_x = x + 1;
+}
+
+/**
+ * Sends the whole buffer with as few write calls as the terminal allows, normally one.
+ * @param term
+ */
+static void flush(tm_terminal *term) {
+	size_t done = 0;
+	while (done < term->out_len) {
+		ssize_t n = write(term->fd, term->out + done, term->out_len - done);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			break;
+		}
+		done += n;
+	}
+	term->bytes += done;
+	term->last_frame_bytes = done;
+	term->out_len = 0;
+}
+
+/**
+ * Encodes all cells that changed since the previous frame and sends them in one write.
+ * @param renderer
+ */
+static void term_present(rd_renderer *renderer) {
+	tm_terminal *term = (tm_terminal *)renderer;
+	rd_framebuffer *frame = &term->frame;
+	if (term->full_redraw) {
+		emit(term, "\x1b[0m\x1b[H\x1b[2J", 11);
+		term->cursor_y = term->cursor_x = 0;
+		term->fg = term->bg = -1;
+		for (int i = 0; i < frame->rows * frame->cols; i++) {
+			term->shown[i] = (rd_cell){ ' ', 0 };
+		}
+		term->full_redraw = false;
+	}
+	for (int y = 0; y < frame->rows; y++) {
+		for (int x = 0; x < frame->cols; x++) {
+			rd_cell cell = *rd_cell_at(frame, y, x);
+			rd_cell *shown = &term->shown[y * frame->cols + x];
+			if (cell.ch != shown->ch || cell.color != shown->color) {
+				emit_cell(term, y, x, cell);
+				*shown = cell;
+			}
+		}
+	}
+	++frame->frames;
+	++term->frames;
+	flush(term);
+}
+
+/**
+ * Initializes the backend for a screen area of the given size starting at the top left corner.
+ * @param term
+ * @param fd file descriptor of the terminal.
+ * @param rows
+ * @param cols
+ * @param half_blocks draw two board rows per terminal row using Unicode half blocks.
+ * @return false if the buffers could not be allocated.
+ */
+bool tm_init(tm_terminal *term, int fd, int rows, int cols, bool half_blocks) {
+	memset(term, 0, sizeof(*term));
+	if (!rd_init_framebuffer(&term->frame, rows, cols)) {
+		return false;
+	}
+	term->frame.base.present = term_present;
+	term->frame.base.half_blocks = half_blocks;
+	term->fd = fd;
+	term->full_redraw = true;
+	term->out_size = (size_t)rows * cols * MAX_CELL_BYTES + 16;
+	term->out = malloc(term->out_size);
+	term->shown = malloc(sizeof(*term->shown) * rows * cols);
+	if (!term->out || !term->shown) {
+		tm_destroy(term);
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Frees all buffers of the backend.
+ * @param term
+ */
+void tm_destroy(tm_terminal *term) {
+	rd_destroy_framebuffer(&term->frame);
+	free(term->out);
+	free(term->shown);
+	term->out = NULL;
+	term->shown = NULL;
+}
+
+/**
+ * Makes the next frame clear the screen and draw every cell, e.g. after curses drew over it.
+ * @param term
+ */
+void tm_invalidate(tm_terminal *term) {
+	term->full_redraw = true;
+}
+
+/**
+ * Resets the colors of the terminal, so curses can take over the screen again.
+ * @param term
+ */
+void tm_release(tm_terminal *term) {
+	emit(term, "\x1b[0m", 4);
+	flush(term);
+	term->full_redraw = true;
+}
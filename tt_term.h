@@ -0,0 +1,57 @@
+#ifndef TT_TERM_H
+#define TT_TERM_H
+
+#include "tt_render.h"
+
+/**
+ * Low-bandwidth render backend writing its own escape sequences instead of going through curses.
+ * Frames are composed into a framebuffer. On present only the cells that differ from the frame
+ * shown before are encoded, all into one buffer that is sent with a single write().
+ * With half blocks enabled the board is drawn with two rows per terminal row.
+ */
+typedef struct {
+	rd_framebuffer frame;
+	rd_cell *shown;
+	int fd;
+	bool full_redraw;
+
+	char *out;
+	size_t out_size, out_len;
+	int cursor_y, cursor_x;
+	int fg, bg;
+
+	unsigned long long frames;
+	unsigned long long bytes;
+	unsigned long long last_frame_bytes;
+} tm_terminal;
+
+/**
+ * Initializes the backend for a screen area of the given size starting at the top left corner.
+ * @param term
+ * @param fd file descriptor of the terminal.
+ * @param rows
+ * @param cols
+ * @param half_blocks draw two board rows per terminal row using Unicode half blocks.
+ * @return false if the buffers could not be allocated.
+ */
+bool tm_init(tm_terminal *term, int fd, int rows, int cols, bool half_blocks);
+
+/**
+ * Frees all buffers of the backend.
+ * @param term
+ */
+void tm_destroy(tm_terminal *term);
+
+/**
+ * Makes the next frame clear the screen and draw every cell, e.g. after curses drew over it.
+ * @param term
+ */
+void tm_invalidate(tm_terminal *term);
+
+/**
+ * Resets the colors of the terminal, so curses can take over the screen again.
+ * @param term
+ */
+void tm_release(tm_terminal *term);
+
+#endif // TT_TERM_H
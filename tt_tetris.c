@@ -1,23 +1,42 @@
+#include "tt_perf.h"
 #include "tt_tetris.h"
 
 /**
  * Initializes all windows and structs.
+ * With instrumentation enabled, curses writes through a stream that counts the bytes sent to the
+ * terminal.
+ * @param perf counters the terminal output and frame times are recorded to, NULL to disable.
+ * @param rows height of the board.
+ * @param cols width of the board.
  * @return a new tt_tetris struct containing all information needed to execute other functions in
- * this program.
+ * this program, NULL if the board size is invalid or the windows do not fit the terminal.
  */
-tt_tetris *tt_init_tetris() {
-	initscr();
+tt_tetris *tt_init_tetris(pf_stats *perf, int rows, int cols) {
+	if (!perf || !newterm(NULL, pf_terminal(perf), stdin)) {
+		initscr();
+	}
 	if (has_colors()) enable_color();
 	refresh();
 	nodelay(stdscr, TRUE);
 	timeout(TIME_DELAY);
 	keypad(stdscr, TRUE);
+	cbreak();
 	noecho();
 
 	tt_tetris *tetris = malloc(sizeof(*tetris));
 	if (!tetris) {
 		return NULL;
 	}
+	if (!bd_resize(tetris, rows, cols)) {
+		endwin();
+		fprintf(stderr, "Board size must be between %dx%d and %dx%d!\n", BOARD_MIN_X, BOARD_MIN_Y,
+		        BOARD_MAX_X, BOARD_MAX_Y);
+		free(tetris);
+		return NULL;
+	}
+	tetris->broadcast = NULL;
+	tetris->animation = NULL;
+	tetris->perf = perf;
 	gm_init_game(tetris);
 	if (!dw_init_windows(tetris)) {
 		tt_destroy_tetris(tetris);
@@ -41,6 +60,7 @@ void enable_color() {
 		// initialize color pairs (conveniently mapped from 0..black to 7..white)
 		init_pair(i, i, COLOR_BLACK);
 	}
+	init_pair(GARBAGE_BLOCK, COLOR_BLACK, COLOR_WHITE);
 	// init_pair(1, COLOR_RED, COLOR_BLACK);
 	// init_pair(2, COLOR_GREEN, COLOR_BLACK);
 	// init_pair(3, COLOR_YELLOW, COLOR_BLACK);
@@ -1,15 +1,19 @@
 #ifndef TT_TETRIS_H
 #define TT_TETRIS_H
 
+#include "tt_board.h"
 #include "tt_draw.h"
 #include "tt_game.h"
 
 /**
  * Initializes all windows and structs.
+ * @param perf counters the terminal output and frame times are recorded to, NULL to disable.
+ * @param rows height of the board.
+ * @param cols width of the board.
  * @return a new tt_tetris struct containing all information needed to execute other functions in
- * this program.
+ * this program, NULL if the board size is invalid or the windows do not fit the terminal.
  */
-tt_tetris *tt_init_tetris();
+tt_tetris *tt_init_tetris(struct pf_stats *perf, int rows, int cols);
 
 /**
  * Initializes all windows and structs.
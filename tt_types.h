@@ -3,16 +3,31 @@
 
 #include <ncurses.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
-/** Defines the height of the tetris board. */
+/** Defines the default height of the tetris board. */
 #define BOARD_Y 20
-/** Defines the width of the tetris board. */
+/** Defines the default width of the tetris board. */
 #define BOARD_X 11
 
-/** Defines the initial falling speed of a tetris block. */
-#define INIT_SPEED 500000
+/** Defines the largest height a board can be given at startup. */
+#define BOARD_MAX_Y 64
+/** Defines the largest width a board can be given at startup, a row has to fit a 64 bit word. */
+#define BOARD_MAX_X 64
+
+/** Duration of one game tick in microseconds. Gravity and lock delay are counted in ticks. */
+#define TICK_US 16667
+
+/** Number of ticks a block may rest on the stack before it locks. */
+#define LOCK_DELAY 30
+
+/** Number of times moving or rotating a resting block restarts its lock delay. */
+#define LOCK_RESETS 15
+
+/** Number of cleared lines that raise the level by one. */
+#define LINES_PER_LEVEL 10
 
 /** Time delay between the frames rendered. This waiting is performed at every wgetch call. */
 #define TIME_DELAY 10
@@ -25,16 +40,21 @@
 #define I_BLOCK 5
 #define S_BLOCK 6
 #define Z_BLOCK 7
+#define GARBAGE_BLOCK 8
 
 /**
  * Enum to store the state of the currently selected main menu item.
  */
-typedef enum { NEW_GAME, HIGH_SCORE, HELP_MENU, QUIT } cursor_main_menu;
+typedef enum { NEW_GAME, VERSUS, HIGH_SCORE, HELP_MENU, QUIT } cursor_main_menu;
 
 /**
- * Enum to list all possible block movements.
+ * Enum to list all possible block movements. TT_TICK is the pull of gravity once per game tick,
+ * TT_LEVEL_UP and TT_LEVEL_DOWN change the level and with it the gravity.
  */
-enum tt_movement { TT_LEFT, TT_RIGHT, TT_DOWN, TT_FALL_DOWN, TT_ROTATE, TT_ALTER_TIME };
+enum tt_movement {
+	TT_LEFT, TT_RIGHT, TT_DOWN, TT_FALL_DOWN, TT_ROTATE, TT_ALTER_TIME, TT_TICK, TT_LEVEL_UP,
+	TT_LEVEL_DOWN
+};
 
 /**
  * Packs all needed information about a block into a struct.
@@ -64,26 +84,58 @@ typedef struct {
  *
  * The information stored into this struct are:
  *  - the current tetris board as an array, which stores all free or occupied pixels
+ *  - the size of the board picked at startup, only the top left rows x cols pixels are used
+ *  - one word per row with a bit set for every occupied pixel, in the width class of the board
+ *  - the collision, lock and line clear kernels for that width class
  *  - the upcoming falling block
  *  - the currently falling block
+ *  - the block locked last together with the rows it cleared (bit i stands for row y + i)
  *  - the score of the current game
- *  - the current falling speed of the blocks
+ *  - the number of lines cleared in the current game
+ *  - the current level, which selects the gravity
+ *  - the part of a row the block has fallen since it last moved down, as 16.16 fixed point
+ *  - the ticks the block has been resting on the stack and how often that has been restarted
+ *  - the state of the random generator that picks the blocks
  *
  *  - four different windows that can be rendered with ncurses
+ *  - the render backend the game window is drawn with, by default the one for w_game
+ *  - the spectator stream the game is broadcast to, if any
+ *  - the line clear effects overlaid on the board, if any
+ *  - the frame time and latency counters, if instrumentation is enabled
  */
 typedef struct {
-	char board[BOARD_Y][BOARD_X];
+	char board[BOARD_MAX_Y][BOARD_MAX_X];
+	int rows, cols;
+	union {
+		uint16_t w16[BOARD_MAX_Y];
+		uint32_t w32[BOARD_MAX_Y];
+		uint64_t w64[BOARD_MAX_Y];
+	} row_bits;
+	const struct bd_kernels *kernels;
 	tetris_block next_block;
 	tetris_block current_block;
+	tetris_block last_locked;
+	unsigned last_cleared;
 	unsigned score;
-	unsigned speed;
+	unsigned lines;
+	unsigned level;
+	uint32_t gravity;
+	int lock_ticks;
+	int lock_resets;
 	unsigned block_count;
+	uint32_t rng;
 
 	WINDOW *w_main;
 	WINDOW *w_help;
 	WINDOW *w_highscore; 
 	WINDOW *w_game;
 	WINDOW *w_game_over;
+	struct rd_renderer *renderer;
+	struct rd_renderer *curses_renderer;
+
+	struct st_stream *broadcast;
+	struct an_timeline *animation;
+	struct pf_stats *perf;
 } tt_tetris;
 
 #endif // TT_TYPES_H
@@ -0,0 +1,469 @@
+#include <ctype.h>
+
+#include "tt_anim.h"
+#include "tt_draw.h"
+#include "tt_game.h"
+#include "tt_perf.h"
+#include "tt_score.h"
+#include "tt_stream.h"
+#include "tt_ui.h"
+
+/**
+ * Lets curses take over the screen again after the low-bandwidth backend drew on it behind its
+ * back. The last frame is drawn once more through curses, so the popups following it keep it as
+ * their background.
+ * @param session
+ * @param match the versus match shown last or NULL for a single game.
+ */
+static void hand_back_screen(ui_session *session, vs_match *match) {
+	tt_tetris *tetris = session->tetris;
+	if (!session->low_bandwidth) {
+		return;
+	}
+	tm_release(session->low_bandwidth);
+	clearok(curscr, TRUE);
+	tetris->renderer = tetris->curses_renderer;
+	if (match) dw_draw_versus_window(tetris, match);
+	else dw_draw_game_window(tetris);
+	tetris->renderer = &session->low_bandwidth->frame.base;
+}
+
+/**
+ * Shows a window over the current screen till any key is pressed.
+ * @param session
+ * @param window
+ * @param back screen to go back to afterwards.
+ */
+static void open_popup(ui_session *session, WINDOW *window, ui_state back) {
+	session->popup = window;
+	session->back = back;
+	session->state = UI_POPUP;
+	dw_show_window(window);
+}
+
+/**
+ * Restarts the game clock, so the time spent on another screen is not caught up with.
+ * @param session
+ */
+static void restart_clock(ui_session *session) {
+	session->last_tick = session->now;
+	session->lag = 0;
+}
+
+/**
+ * Feeds an input to the single game and records it.
+ * @param session
+ * @param move
+ */
+static void play(ui_session *session, enum tt_movement move) {
+	gm_move_block(session->tetris, move);
+	if (session->recorder) {
+		rp_move(session->recorder, move);
+	}
+}
+
+/**
+ * Feeds the inputs of a placement of the bot to the single game, the same ones as bt_steer, one
+ * by one so they are recorded.
+ * @param session
+ * @param move
+ */
+static void steer(ui_session *session, bt_move move) {
+	tt_tetris *tetris = session->tetris;
+	for (int i = 0; i < move.rotations; i++) {
+		play(session, TT_ROTATE);
+	}
+	while (!would_collide(tetris, tetris->current_block, -1, 0)) {
+		play(session, TT_LEFT);
+	}
+	for (int i = 0; i < move.shift; i++) {
+		play(session, TT_RIGHT);
+	}
+}
+
+/**
+ * Starts a new game. Every game gets a seed of its own, so a recorded game can be replayed from
+ * its seed and inputs.
+ * It calls the following external functions:
+ *  - gm_seed_game
+ *  - dw_draw_game_window
+ * @param session
+ */
+static void start_game(ui_session *session) {
+	tt_tetris *tetris = session->tetris;
+	uint32_t seed = (uint32_t)rand();
+	if (session->recorder) {
+		rp_finish(session->recorder, tetris);
+	}
+	gm_seed_game(tetris, seed);
+	if (session->recorder) {
+		rp_start(session->recorder, tetris, seed);
+	}
+	if (session->low_bandwidth) tm_invalidate(session->low_bandwidth);
+	an_restart(tetris->animation, tetris);
+	touchwin(tetris->w_game);
+	dw_draw_game_window(tetris);
+	if (tetris->broadcast) {
+		st_restart(tetris->broadcast);
+		st_write_tick(tetris->broadcast, tetris);
+	}
+	if (session->practice) {
+		rw_restart(session->practice, tetris);
+	}
+	session->steered = tetris->block_count - 1;
+	restart_clock(session);
+	session->state = UI_GAME;
+}
+
+/**
+ * Goes back to a screen a popup has been shown over and draws it again. Going back to a game
+ * that is over starts a new one.
+ * @param session
+ * @param state
+ */
+static void resume(ui_session *session, ui_state state) {
+	tt_tetris *tetris = session->tetris;
+	session->state = state;
+	switch (state) {
+	case UI_MAIN_MENU:
+		touchwin(tetris->w_main);
+		dw_draw_main_menu(tetris, session->cursor);
+		break;
+	case UI_GAME:
+		if (gm_is_game_over(tetris)) {
+			start_game(session);
+			break;
+		}
+		if (session->low_bandwidth) tm_invalidate(session->low_bandwidth);
+		touchwin(tetris->w_game);
+		dw_draw_game_window(tetris);
+		restart_clock(session);
+		break;
+	default: break;
+	}
+}
+
+/**
+ * Ends a game that is over: asks for a name if the score made it into the highscores and shows
+ * the game over window.
+ * @param session
+ */
+static void end_game(ui_session *session) {
+	tt_tetris *tetris = session->tetris;
+	hand_back_screen(session, NULL);
+	if (session->recorder) {
+		rp_finish(session->recorder, tetris);
+	}
+	if (is_highscore(tetris->score)) {
+		session->name[0] = '\0';
+		session->name_length = 0;
+		session->state = UI_NAME_ENTRY;
+		dw_draw_name_entry(tetris, session->name);
+		return;
+	}
+	dw_draw_game_over(tetris);
+	open_popup(session, tetris->w_game_over, UI_GAME);
+}
+
+/**
+ * Function for navigating through the different menu options.
+ * @param session
+ * @param key that has been pressed.
+ */
+static void step_main_menu(ui_session *session, int key) {
+	tt_tetris *tetris = session->tetris;
+	switch (key) {
+	case KEY_DOWN: session->cursor = (session->cursor + 1) % NUM_MAIN_MENU; break;
+	case KEY_UP: session->cursor = (session->cursor + NUM_MAIN_MENU - 1) % NUM_MAIN_MENU; break;
+	case 'h': open_popup(session, tetris->w_help, UI_MAIN_MENU); return;
+	case 'q': session->state = UI_QUIT; return;
+	case '\n':
+		switch (session->cursor) {
+		case NEW_GAME: start_game(session); return;
+		case VERSUS: ui_start_versus(session, NULL, NULL); return;
+		case HIGH_SCORE: open_popup(session, tetris->w_highscore, UI_MAIN_MENU); return;
+		case HELP_MENU: open_popup(session, tetris->w_help, UI_MAIN_MENU); return;
+		case QUIT: session->state = UI_QUIT; return;
+		}
+		return;
+	case ERR: return;
+	default: break;
+	}
+	dw_draw_main_menu(tetris, session->cursor);
+}
+
+/**
+ * Function that maps a pressed key to the correct block movement.
+ * @param session
+ * @param key that has been pressed.
+ */
+static void game_input(ui_session *session, int key) {
+	tt_tetris *tetris = session->tetris;
+	switch (key) {
+	case KEY_LEFT: play(session, TT_LEFT); break;
+	case KEY_RIGHT: play(session, TT_RIGHT); break;
+	case KEY_DOWN: play(session, TT_DOWN); break;
+	case ' ': play(session, TT_FALL_DOWN); break;
+	case KEY_UP: play(session, TT_ROTATE); break;
+	case 's': play(session, TT_ALTER_TIME); break;
+	case '+': play(session, TT_LEVEL_UP); break;
+	case '-': play(session, TT_LEVEL_DOWN); break;
+	case 'u':
+		if (session->practice) {
+			rw_record(session->practice, tetris);
+			rw_step_back(session->practice, tetris, 1);
+		}
+		break;
+	case 'p':
+		if (tetris->perf) tetris->perf->overlay = !tetris->perf->overlay;
+		break;
+	default: break;
+	}
+}
+
+/**
+ * Runs a game for one step: handles the key, lets the ticks due pass and draws the game.
+ * In practice mode topping out takes back the last piece instead of ending the game.
+ * @param session
+ * @param key that has been pressed.
+ */
+static void step_game(ui_session *session, int key) {
+	tt_tetris *tetris = session->tetris;
+	if (key != ERR && tetris->perf) {
+		pf_key(tetris->perf);
+	}
+	if (key == 'q') {
+		hand_back_screen(session, NULL);
+		resume(session, UI_MAIN_MENU);
+		return;
+	}
+	if (key == 'h') {
+		hand_back_screen(session, NULL);
+		open_popup(session, tetris->w_help, UI_GAME);
+		return;
+	}
+	game_input(session, key);
+	// the bot steers every block once, right after it appeared, and leaves the drop to gravity;
+	// it only searches for positions missing from the placement cache and leaves a block it found
+	// no placement for in time where it is
+	if (session->bot && session->steered != tetris->block_count && !gm_is_game_over(tetris)) {
+		bt_move move;
+		if ((session->cache && pc_lookup(session->cache, tetris, &move)) ||
+		    bt_search_move(session->bot, tetris, &bt_default_weights, UI_BOT_BUDGET_US, &move)) {
+			steer(session, move);
+		}
+		session->steered = tetris->block_count;
+	}
+
+	session->lag += session->now - session->last_tick;
+	session->last_tick = session->now;
+	if (session->lag >= TICK_US && tetris->perf) {
+		pf_record(tetris->perf, PF_GRAVITY_JITTER, session->lag - TICK_US);
+	}
+	// after a stall the game goes on instead of catching up every tick
+	if (session->lag > 4 * TICK_US) {
+		session->lag = 4 * TICK_US;
+	}
+	for (; session->lag >= TICK_US; session->lag -= TICK_US) {
+		play(session, TT_TICK);
+	}
+	if (session->practice) {
+		rw_record(session->practice, tetris);
+	}
+	an_advance(tetris->animation, tetris, session->now);
+	if (tetris->perf) pf_render_begin(tetris->perf);
+	dw_draw_game_window(tetris);
+	if (tetris->perf) pf_render_end(tetris->perf);
+	if (tetris->broadcast) {
+		st_write_tick(tetris->broadcast, tetris);
+	}
+	if (gm_is_game_over(tetris) && !(session->practice && rw_step_back(session->practice, tetris, 1))) {
+		end_game(session);
+	}
+}
+
+/**
+ * Takes the name of a new highscore key by key. Enter saves it and shows the game over window.
+ * @param session
+ * @param key that has been pressed.
+ */
+static void step_name_entry(ui_session *session, int key) {
+	tt_tetris *tetris = session->tetris;
+	if (key == '\n') {
+		bool saved = update_highscores(tetris->score, session->name_length ? session->name : "NA");
+		dw_draw_game_over(tetris);
+		if (!saved) {
+			mvwaddstr(tetris->w_game_over, 10, 3, "Couldn't save the highscore!");
+		}
+		open_popup(session, tetris->w_game_over, UI_GAME);
+		return;
+	}
+	if ((key == KEY_BACKSPACE || key == 127 || key == '\b') && session->name_length) {
+		session->name[--session->name_length] = '\0';
+	} else if (key >= 0 && key < 128 && isgraph(key) && session->name_length + 1 < (int)sizeof(session->name)) {
+		session->name[session->name_length++] = (char)key;
+		session->name[session->name_length] = '\0';
+	} else {
+		return;
+	}
+	dw_draw_name_entry(tetris, session->name);
+}
+
+/**
+ * Function that maps a pressed key to the block movement of the matching versus player.
+ * Player one uses a, d, s, w and Tab, player two the arrow keys and Space, player three j, l, k, i
+ * and Enter and player four 4, 6, 5, 8 and 0. Keys of players not taking part are ignored.
+ * If the opponent is remote, the only local player uses the arrow keys.
+ * @param match
+ * @param key that has been pressed.
+ */
+static void versus_input(vs_match *match, int key) {
+	int second = match->players[1].is_remote ? 0 : 1;
+	switch (key) {
+	case 'a': vs_move_block(match, 0, TT_LEFT); break;
+	case 'd': vs_move_block(match, 0, TT_RIGHT); break;
+	case 's': vs_move_block(match, 0, TT_DOWN); break;
+	case 'w': vs_move_block(match, 0, TT_ROTATE); break;
+	case '\t': vs_move_block(match, 0, TT_FALL_DOWN); break;
+	case KEY_LEFT: vs_move_block(match, second, TT_LEFT); break;
+	case KEY_RIGHT: vs_move_block(match, second, TT_RIGHT); break;
+	case KEY_DOWN: vs_move_block(match, second, TT_DOWN); break;
+	case KEY_UP: vs_move_block(match, second, TT_ROTATE); break;
+	case ' ': vs_move_block(match, second, TT_FALL_DOWN); break;
+	case 'j': vs_move_block(match, 2, TT_LEFT); break;
+	case 'l': vs_move_block(match, 2, TT_RIGHT); break;
+	case 'k': vs_move_block(match, 2, TT_DOWN); break;
+	case 'i': vs_move_block(match, 2, TT_ROTATE); break;
+	case '\n': vs_move_block(match, 2, TT_FALL_DOWN); break;
+	case '4': vs_move_block(match, 3, TT_LEFT); break;
+	case '6': vs_move_block(match, 3, TT_RIGHT); break;
+	case '5': vs_move_block(match, 3, TT_DOWN); break;
+	case '8': vs_move_block(match, 3, TT_ROTATE); break;
+	case '0': vs_move_block(match, 3, TT_FALL_DOWN); break;
+	default: break;
+	}
+}
+
+/**
+ * Starts a versus match. Without host or join, the versus players of the session share the
+ * keyboard. Otherwise the only local player plays against the opponent on the other end of the
+ * local socket, which is waited for before returning; a socket connects exactly two processes.
+ * @param session
+ * @param host path of the socket to wait on or NULL.
+ * @param join path of the socket to connect to or NULL.
+ * @return false if the match could not be started, the session stays on the main menu then.
+ */
+bool ui_start_versus(ui_session *session, const char *host, const char *join) {
+	tt_tetris *tetris = session->tetris;
+	vs_match *match = &session->match;
+	bool remote = host || join;
+	if (!vs_init_match(match, remote ? 1 : session->versus_players, (uint32_t)rand())) {
+		vs_destroy_match(match);
+		return false;
+	}
+	if (remote) {
+		werase(tetris->w_game);
+		box(tetris->w_game, 0, 0);
+		mvwprintw(tetris->w_game, MAIN_WIN_Y / 2, MAIN_WIN_X / 2 - 12, "Waiting for opponent...");
+		wrefresh(tetris->w_game);
+		if (!(host ? vs_host(match, host) : vs_join(match, join))) {
+			vs_destroy_match(match);
+			resume(session, UI_MAIN_MENU);
+			return false;
+		}
+	}
+	if (session->low_bandwidth) tm_invalidate(session->low_bandwidth);
+	dw_draw_versus_window(tetris, match);
+	restart_clock(session);
+	session->state = UI_VERSUS;
+	return true;
+}
+
+/**
+ * Runs a versus match for one step. All local players share the game ticks, garbage is
+ * delivered once per step. Once the match is decided or quit has been pressed, the game over
+ * window of the match is shown.
+ * @param session
+ * @param key that has been pressed.
+ */
+static void step_versus(ui_session *session, int key) {
+	tt_tetris *tetris = session->tetris;
+	vs_match *match = &session->match;
+	if (key != 'q') {
+		if (key != ERR) {
+			versus_input(match, key);
+		}
+		session->lag += session->now - session->last_tick;
+		session->last_tick = session->now;
+		if (session->lag > 4 * TICK_US) {
+			session->lag = 4 * TICK_US;
+		}
+		for (; session->lag >= TICK_US; session->lag -= TICK_US) {
+			for (int i = 0; i < match->count; i++) {
+				vs_move_block(match, i, TT_TICK);
+			}
+		}
+		vs_update(match);
+		dw_draw_versus_window(tetris, match);
+		if (vs_winner(match) == -1) {
+			return;
+		}
+	}
+	hand_back_screen(session, match);
+	dw_draw_versus_over(tetris, match);
+	vs_destroy_match(match);
+	open_popup(session, tetris->w_game_over, UI_MAIN_MENU);
+}
+
+/**
+ * Starts a session on the main menu.
+ * @param session
+ * @param tetris game and windows of the session.
+ * @param low_bandwidth backend the games are drawn with instead of curses, NULL if not enabled.
+ * @param practice history of the pieces of a game in practice mode, NULL if not enabled.
+ * @param bot search pool of the bot playing the single games, NULL to let the player play.
+ * @param cache placements the bot looks up before it searches, NULL if there are none.
+ * @param recorder archive the single games are recorded to, NULL if they are not recorded.
+ * @param versus_players number of players sharing the keyboard in a versus match, 2 to VS_MAX_PLAYERS.
+ * @param now current time in microseconds.
+ */
+void ui_init(ui_session *session, tt_tetris *tetris, tm_terminal *low_bandwidth, rw_history *practice, bt_searcher *bot,
+             pc_cache *cache, rp_recorder *recorder, int versus_players, long long now) {
+	session->tetris = tetris;
+	session->low_bandwidth = low_bandwidth;
+	session->practice = practice;
+	session->bot = bot;
+	session->cache = cache;
+	session->recorder = recorder;
+	session->versus_players = versus_players;
+	session->cursor = NEW_GAME;
+	session->now = now;
+	session->popup = NULL;
+	session->name[0] = '\0';
+	session->name_length = 0;
+	restart_clock(session);
+	resume(session, UI_MAIN_MENU);
+}
+
+/**
+ * Moves a session on by one step: handles the key pressed, if any, lets the game ticks due
+ * until now pass and draws what changed. Menus and popups only draw when a key changed them.
+ * @param session
+ * @param key pressed or ERR.
+ * @param now current time in microseconds.
+ * @return false once the session has ended.
+ */
+bool ui_step(ui_session *session, int key, long long now) {
+	session->now = now;
+	switch (session->state) {
+	case UI_MAIN_MENU: step_main_menu(session, key); break;
+	case UI_GAME: step_game(session, key); break;
+	case UI_VERSUS: step_versus(session, key); break;
+	case UI_NAME_ENTRY: step_name_entry(session, key); break;
+	case UI_POPUP:
+		if (key != ERR) resume(session, session->back);
+		break;
+	case UI_QUIT: break;
+	}
+	return session->state != UI_QUIT;
+}
@@ -0,0 +1,96 @@
+#ifndef TT_UI_H
+#define TT_UI_H
+
+#include "tt_bot.h"
+#include "tt_cache.h"
+#include "tt_replay.h"
+#include "tt_rewind.h"
+#include "tt_term.h"
+#include "tt_types.h"
+#include "tt_versus.h"
+
+/** Time the bot may search for the placement of a block in microseconds. */
+#define UI_BOT_BUDGET_US 1000
+
+/**
+ * Screens a session can be on:
+ *  - UI_MAIN_MENU: the main menu with the cursor on one of its items
+ *  - UI_GAME: a single game running
+ *  - UI_VERSUS: a versus match running
+ *  - UI_NAME_ENTRY: the game is over and the name of a new highscore is typed in
+ *  - UI_POPUP: the help, highscore or game over window is shown till any key is pressed
+ *  - UI_QUIT: the session has ended
+ */
+typedef enum { UI_MAIN_MENU, UI_GAME, UI_VERSUS, UI_NAME_ENTRY, UI_POPUP, UI_QUIT } ui_state;
+
+/**
+ * Everything a player sees and does between the start of the program and quitting it.
+ * Every screen is a state that handles a single key per step and returns at once, nothing waits
+ * for input on its own, so the same loop drives the menus, popups and games and a process could
+ * step any number of sessions side by side.
+ */
+typedef struct {
+	tt_tetris *tetris;
+	tm_terminal *low_bandwidth;
+	rw_history *practice;
+	bt_searcher *bot;
+	pc_cache *cache;
+	rp_recorder *recorder;
+	unsigned steered; // block_count of the block the bot steered last
+	int versus_players; // players sharing the keyboard in a versus match
+
+	ui_state state;
+	cursor_main_menu cursor;
+	long long now;
+
+	// the popup shown and the screen it goes back to
+	WINDOW *popup;
+	ui_state back;
+
+	// the game clock, in microseconds
+	long long last_tick;
+	long lag;
+
+	char name[sizeof(((highscore *)0)->name)];
+	int name_length;
+
+	vs_match match;
+} ui_session;
+
+/**
+ * Starts a session on the main menu.
+ * @param session
+ * @param tetris game and windows of the session.
+ * @param low_bandwidth backend the games are drawn with instead of curses, NULL if not enabled.
+ * @param practice history of the pieces of a game in practice mode, NULL if not enabled.
+ * @param bot search pool of the bot playing the single games, NULL to let the player play.
+ * @param cache placements the bot looks up before it searches, NULL if there are none.
+ * @param recorder archive the single games are recorded to, NULL if they are not recorded.
+ * @param versus_players number of players sharing the keyboard in a versus match, 2 to VS_MAX_PLAYERS.
+ * @param now current time in microseconds.
+ */
+void ui_init(ui_session *session, tt_tetris *tetris, tm_terminal *low_bandwidth, rw_history *practice, bt_searcher *bot,
+             pc_cache *cache, rp_recorder *recorder, int versus_players, long long now);
+
+/**
+ * Starts a versus match. Without host or join, the versus players of the session share the
+ * keyboard. Otherwise the only local player plays against the opponent on the other end of the
+ * local socket, which is waited for before returning; a socket connects exactly two processes.
+ * @param session
+ * @param host path of the socket to wait on or NULL.
+ * @param join path of the socket to connect to or NULL.
+ * @return false if the match could not be started, the session stays on the main menu then.
+ */
+bool ui_start_versus(ui_session *session, const char *host, const char *join);
+
+/**
+ * Moves a session on by one step: handles the key pressed, if any, lets the game ticks due
+ * until now pass and draws what changed.
+ * @param session
+ * @param key pressed or ERR.
+ * @param now current time in microseconds.
+ * @return false once the session has ended.
+ */
+bool ui_step(ui_session *session, int key, long long now);
+
+#endif // TT_UI_H
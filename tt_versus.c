@@ -0,0 +1,379 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "tt_board.h"
+#include "tt_game.h"
+#include "tt_versus.h"
+
+/**
+ * Number of garbage rows sent for clearing one, two, three or four lines at once.
+ */
+static const int garbage_table[5] = { 0, 0, 1, 2, 4 };
+
+/**
+ * Reads the monotonic clock.
+ * @return the current time in nanoseconds.
+ */
+long long vs_now_ns() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+/**
+ * Initializes a match for the given number of local players, which all get the same seed.
+ * @param match
+ * @param local_players number of players playing in this process.
+ * @param seed
+ * @return false if the games or event rings could not be allocated.
+ */
+bool vs_init_match(vs_match *match, int local_players, uint32_t seed) {
+	memset(match, 0, sizeof(*match));
+	match->socket = -1;
+	match->seed = seed;
+	match->latency_min_ns = -1;
+	if (local_players < 1 || local_players > VS_MAX_PLAYERS) {
+		return false;
+	}
+	for (int i = 0; i < VS_MAX_PLAYERS; i++) {
+		for (int j = 0; j < VS_MAX_PLAYERS; j++) {
+			if (!rb_init(&match->players[i].inbox[j], VS_INBOX_SIZE, sizeof(vs_event))) {
+				vs_destroy_match(match);
+				return false;
+			}
+		}
+	}
+	for (int i = 0; i < local_players; i++) {
+		vs_player *player = &match->players[i];
+		player->tetris = calloc(1, sizeof(*player->tetris));
+		if (!player->tetris) {
+			vs_destroy_match(match);
+			return false;
+		}
+		bd_resize(player->tetris, BOARD_Y, BOARD_X);
+		gm_seed_game(player->tetris, seed);
+		player->next_target = i + 1;
+		player->block_count_seen = player->tetris->block_count;
+	}
+	match->count = local_players;
+	return true;
+}
+
+/**
+ * Frees all games and rings of a match and closes its socket.
+ * @param match
+ */
+void vs_destroy_match(vs_match *match) {
+	for (int i = 0; i < VS_MAX_PLAYERS; i++) {
+		free(match->players[i].tetris);
+		match->players[i].tetris = NULL;
+		for (int j = 0; j < VS_MAX_PLAYERS; j++) {
+			rb_destroy(&match->players[i].inbox[j]);
+		}
+	}
+	if (match->socket >= 0) {
+		close(match->socket);
+		match->socket = -1;
+	}
+}
+
+/**
+ * Hands an event over to a player. Remote players receive it over the socket, local players
+ * through the ring reserved for the sender. An event the socket has no room for is dropped as a
+ * whole, as the socket sends every event in one piece or not at all.
+ * @param match
+ * @param to index of the receiving player.
+ * @param event
+ */
+static void send_event(vs_match *match, int to, vs_event *event) {
+	bool sent;
+	if (match->players[to].is_remote) {
+		sent = write(match->socket, event, sizeof(*event)) == sizeof(*event);
+	} else {
+		sent = rb_push(&match->players[to].inbox[event->from], event);
+	}
+	if (!sent) ++match->dropped_events;
+}
+
+/**
+ * Tells all other players that the given player has lost.
+ * @param match
+ * @param player
+ */
+static void top_out(vs_match *match, int player) {
+	vs_event event = { VS_TOP_OUT, player, 0, 0, 0, vs_now_ns() };
+	match->players[player].is_over = true;
+	for (int i = 0; i < match->count; i++) {
+		if (i != player) send_event(match, i, &event);
+	}
+}
+
+/**
+ * Picks the next opponent that receives garbage. Targets rotate between all players still alive.
+ * @param match
+ * @param player the attacking player.
+ * @return the index of the target or -1 if no opponent is left.
+ */
+static int next_target(vs_match *match, int player) {
+	for (int n = 0; n < match->count; n++) {
+		int target = (match->players[player].next_target + n) % match->count;
+		if (target != player && !match->players[target].is_over) {
+			match->players[player].next_target = target + 1;
+			return target;
+		}
+	}
+	return -1;
+}
+
+/**
+ * Compares the game of a local player with the state seen after the previous move.
+ * Cleared lines first cancel pending garbage, the rest is sent to an opponent.
+ * When a block has been locked without clearing lines, the pending garbage is applied.
+ * @param match
+ * @param index
+ */
+static void after_move(vs_match *match, int index) {
+	vs_player *player = &match->players[index];
+	tt_tetris *tetris = player->tetris;
+
+	unsigned cleared = tetris->lines - player->lines_seen;
+	player->lines_seen = tetris->lines;
+	if (cleared) {
+		int attack = garbage_table[cleared > 4 ? 4 : cleared];
+		int cancel = attack < player->pending_garbage ? attack : player->pending_garbage;
+		player->pending_garbage -= cancel;
+		attack -= cancel;
+		int target = attack ? next_target(match, index) : -1;
+		if (target >= 0) {
+			vs_event event = { VS_GARBAGE, index, attack, gm_random(tetris) % tetris->cols, 0, vs_now_ns() };
+			send_event(match, target, &event);
+		}
+	}
+
+	bool alive = true;
+	if (tetris->block_count != player->block_count_seen) {
+		player->block_count_seen = tetris->block_count;
+		if (!cleared && player->pending_garbage) {
+			alive = gm_add_garbage(tetris, player->pending_garbage, player->pending_hole);
+			player->pending_garbage = 0;
+		}
+	}
+	if (!alive || gm_is_game_over(tetris)) {
+		top_out(match, index);
+	}
+}
+
+/**
+ * Moves the block of a local player. Line clears caused by the move are sent as garbage.
+ * @param match
+ * @param player index of the local player.
+ * @param move
+ */
+void vs_move_block(vs_match *match, int player, enum tt_movement move) {
+	if (player >= match->count || match->players[player].is_remote || match->players[player].is_over) {
+		return;
+	}
+	gm_move_block(match->players[player].tetris, move);
+	after_move(match, player);
+}
+
+/**
+ * Reads all events from the socket and queues them for the first local player alive.
+ * The socket only connects two processes, so every incoming event is meant for this side.
+ * @param match
+ */
+static void poll_socket(vs_match *match) {
+	int remote = match->count - 1;
+	while (true) {
+		vs_event event;
+		ssize_t n = read(match->socket, &event, sizeof(event));
+		if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR)) {
+			// the opponent is gone, which counts as a loss on their side
+			match->players[remote].is_over = true;
+			return;
+		}
+		if (n < 0) {
+			return;
+		}
+		if (n != sizeof(event)) {
+			continue;
+		}
+		event.from = remote;
+		for (int i = 0; i < remote; i++) {
+			if (!match->players[i].is_over) {
+				send_event(match, i, &event);
+				break;
+			}
+		}
+		if (event.type == VS_TOP_OUT) match->players[remote].is_over = true;
+	}
+}
+
+/**
+ * Records the delivery time of a garbage event.
+ * @param match
+ * @param event
+ */
+static void record_latency(vs_match *match, vs_event *event) {
+	long long latency = vs_now_ns() - event->sent_ns;
+	++match->latency_count;
+	match->latency_sum_ns += latency;
+	if (match->latency_min_ns < 0 || latency < match->latency_min_ns) match->latency_min_ns = latency;
+	if (latency > match->latency_max_ns) match->latency_max_ns = latency;
+}
+
+/**
+ * Delivers all pending events: reads the socket, drains the inboxes of all local players and
+ * applies their garbage once their block has been locked.
+ * Has to be called once per frame.
+ * @param match
+ */
+void vs_update(vs_match *match) {
+	if (match->socket >= 0) {
+		poll_socket(match);
+	}
+	for (int i = 0; i < match->count; i++) {
+		vs_player *player = &match->players[i];
+		if (player->is_remote) {
+			continue;
+		}
+		vs_event event;
+		for (int from = 0; from < match->count; from++) {
+			while (rb_pop(&player->inbox[from], &event)) {
+				switch (event.type) {
+				case VS_GARBAGE:
+					record_latency(match, &event);
+					player->pending_garbage += event.lines;
+					player->pending_hole = event.hole;
+					break;
+				case VS_TOP_OUT: match->players[from].is_over = true; break;
+				default: break;
+				}
+			}
+		}
+	}
+}
+
+/**
+ * Checks if the match is decided.
+ * @param match
+ * @return the index of the winner, -2 if everyone lost or -1 if the match is still running.
+ */
+int vs_winner(vs_match *match) {
+	int alive = 0, winner = -2;
+	for (int i = 0; i < match->count; i++) {
+		if (!match->players[i].is_over) {
+			++alive;
+			winner = i;
+		}
+	}
+	return alive > 1 ? -1 : winner;
+}
+
+/**
+ * Adds the opponent on the other end of the socket as remote player and stops the socket from
+ * blocking the frame loop.
+ * @param match
+ * @param fd connected socket.
+ * @return false if there is no room for another player.
+ */
+static bool add_remote(vs_match *match, int fd) {
+	if (match->count >= VS_MAX_PLAYERS) {
+		close(fd);
+		return false;
+	}
+	// a vanished opponent must not kill this process while garbage is sent to it
+	signal(SIGPIPE, SIG_IGN);
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	match->socket = fd;
+	match->players[match->count].is_remote = true;
+	++match->count;
+	return true;
+}
+
+/**
+ * Fills in the address of a local socket.
+ * @param address
+ * @param path
+ * @return false if the path is too long.
+ */
+static bool socket_address(struct sockaddr_un *address, const char *path) {
+	memset(address, 0, sizeof(*address));
+	address->sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(address->sun_path)) {
+		return false;
+	}
+	strcpy(address->sun_path, path);
+	return true;
+}
+
+/**
+ * Waits on a local socket at path until an opponent joins and adds it as remote player.
+ * The seed of the match is sent to the opponent.
+ * @param match
+ * @param path file system path of the socket.
+ * @return false if the socket could not be set up.
+ */
+bool vs_host(vs_match *match, const char *path) {
+	struct sockaddr_un address;
+	if (!socket_address(&address, path)) {
+		return false;
+	}
+	int server = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+	if (server < 0) {
+		return false;
+	}
+	unlink(path);
+	if (bind(server, (struct sockaddr *)&address, sizeof(address)) || listen(server, 1)) {
+		close(server);
+		return false;
+	}
+	int fd = accept(server, NULL, NULL);
+	close(server);
+	unlink(path);
+	if (fd < 0) {
+		return false;
+	}
+	vs_event hello = { VS_HELLO, 0, 0, 0, match->seed, vs_now_ns() };
+	if (write(fd, &hello, sizeof(hello)) != sizeof(hello)) {
+		close(fd);
+		return false;
+	}
+	return add_remote(match, fd);
+}
+
+/**
+ * Connects to an opponent waiting on a local socket at path and adds it as remote player.
+ * The local games are reseeded with the seed of the host.
+ * @param match
+ * @param path file system path of the socket.
+ * @return false if the connection failed.
+ */
+bool vs_join(vs_match *match, const char *path) {
+	struct sockaddr_un address;
+	if (!socket_address(&address, path)) {
+		return false;
+	}
+	int fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+	if (fd < 0) {
+		return false;
+	}
+	vs_event hello;
+	if (connect(fd, (struct sockaddr *)&address, sizeof(address)) || read(fd, &hello, sizeof(hello)) != sizeof(hello)) {
+		close(fd);
+		return false;
+	}
+	match->seed = hello.seed;
+	for (int i = 0; i < match->count; i++) {
+		gm_seed_game(match->players[i].tetris, hello.seed);
+		match->players[i].block_count_seen = match->players[i].tetris->block_count;
+	}
+	return add_remote(match, fd);
+}
@@ -0,0 +1,130 @@
+#ifndef TT_VERSUS_H
+#define TT_VERSUS_H
+
+#include "tt_ring.h"
+#include "tt_types.h"
+
+/** Maximum number of players taking part in a single versus match. */
+#define VS_MAX_PLAYERS 4
+
+/** Number of events that can be pending between two players. Has to be a power of two. */
+#define VS_INBOX_SIZE 64
+
+/**
+ * Enum to list all events players of a versus match can send to each other.
+ */
+enum vs_event_type { VS_HELLO, VS_GARBAGE, VS_TOP_OUT };
+
+/**
+ * A single message between two players. The same layout is used on the local socket, which keeps
+ * the boundaries of its messages, so every read and write carries exactly one event.
+ * sent_ns is taken from the monotonic clock in the tick the lines were cleared.
+ */
+typedef struct {
+	int type;
+	int from;
+	int lines;
+	int hole;
+	uint32_t seed;
+	long long sent_ns;
+} vs_event;
+
+/**
+ * One participant of a versus match.
+ * A remote player has no game of its own in this process, its events come in over the socket.
+ * inbox[i] holds the events sent by player i, so every ring has exactly one producer and one
+ * consumer.
+ */
+typedef struct {
+	tt_tetris *tetris;
+	tt_ring inbox[VS_MAX_PLAYERS];
+	int pending_garbage;
+	int pending_hole;
+	int next_target;
+	unsigned lines_seen;
+	unsigned block_count_seen;
+	bool is_remote;
+	bool is_over;
+} vs_player;
+
+/**
+ * Packs all information about a running versus match.
+ * The latency statistics measure the time from the tick a line clear happened until the garbage
+ * arrived at the opponent.
+ */
+typedef struct {
+	int count;
+	uint32_t seed;
+	vs_player players[VS_MAX_PLAYERS];
+	unsigned dropped_events;
+	int socket;
+
+	unsigned latency_count;
+	long long latency_sum_ns;
+	long long latency_min_ns;
+	long long latency_max_ns;
+} vs_match;
+
+/**
+ * Initializes a match for the given number of local players, which all get the same seed.
+ * @param match
+ * @param local_players number of players playing in this process.
+ * @param seed
+ * @return false if the games or event rings could not be allocated.
+ */
+bool vs_init_match(vs_match *match, int local_players, uint32_t seed);
+
+/**
+ * Frees all games and rings of a match and closes its socket.
+ * @param match
+ */
+void vs_destroy_match(vs_match *match);
+
+/**
+ * Waits on a local socket at path until an opponent joins and adds it as remote player.
+ * The seed of the match is sent to the opponent.
+ * @param match
+ * @param path file system path of the socket.
+ * @return false if the socket could not be set up.
+ */
+bool vs_host(vs_match *match, const char *path);
+
+/**
+ * Connects to an opponent waiting on a local socket at path and adds it as remote player.
+ * The local games are reseeded with the seed of the host.
+ * @param match
+ * @param path file system path of the socket.
+ * @return false if the connection failed.
+ */
+bool vs_join(vs_match *match, const char *path);
+
+/**
+ * Moves the block of a local player. Line clears caused by the move are sent as garbage.
+ * @param match
+ * @param player index of the local player.
+ * @param move
+ */
+void vs_move_block(vs_match *match, int player, enum tt_movement move);
+
+/**
+ * Delivers all pending events: reads the socket, drains the inboxes of all local players and
+ * applies their garbage once their block has been locked.
+ * Has to be called once per frame.
+ * @param match
+ */
+void vs_update(vs_match *match);
+
+/**
+ * Checks if the match is decided.
+ * @param match
+ * @return the index of the winner, -2 if everyone lost or -1 if the match is still running.
+ */
+int vs_winner(vs_match *match);
+
+/**
+ * Reads the monotonic clock.
+ * @return the current time in nanoseconds.
+ */
+long long vs_now_ns();
+
+#endif // TT_VERSUS_H
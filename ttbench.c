@@ -0,0 +1,829 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "tt_bot.h"
+#include "tt_cache.h"
+#include "tt_replay.h"
+#include "tt_rewind.h"
+#include "tt_tetris.h"
+
+/** Number of timed samples taken per benchmark. Percentiles are computed over these. */
+#define SAMPLES 201
+
+/** Number of operations timed together in one sample of a micro benchmark. */
+#define BATCH 256
+
+/** Number of games played by the throughput benchmark. */
+#define GAMES 200
+
+/** Number of frames rendered by the frame rate benchmark. */
+#define FRAMES 2000
+
+/** Time the bot search may take per piece in microseconds. */
+#define BOT_BUDGET_US 1000
+
+/** Fixed seed, so every run works on exactly the same boards and inputs. */
+#define SEED 20240601u
+
+/**
+ * Board sizes the corpora are built for, one per width class of the board kernels.
+ */
+static const int sizes[3][2] = { { BOARD_Y, BOARD_X }, { BOARD_Y, 24 }, { BOARD_Y, 48 } };
+
+/**
+ * A named board the micro benchmarks are run on, kept in a game so its row words are ready.
+ */
+typedef struct {
+	char name[32];
+	tt_tetris game;
+} corpus;
+
+/**
+ * A single collision query: a block and the offset it is tested at.
+ */
+typedef struct {
+	tetris_block block;
+	int x_move, y_move;
+} query;
+
+/** Keeps the compiler from dropping results of the benchmarked functions. */
+static volatile long sink;
+
+static corpus corpora[5 * 3];
+static int corpus_count;
+
+/**
+ * Reads the monotonic clock.
+ * @return the current time in nanoseconds.
+ */
+static long long now_ns() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+	double x = *(const double *)a, y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+/**
+ * Sorts the samples and prints one JSON line with their percentiles.
+ * @param name of the benchmark.
+ * @param corpus name of the board corpus or "-".
+ * @param unit of the samples.
+ * @param samples
+ * @param count
+ * @param extra additional JSON members (without braces) or NULL.
+ */
+static void report(const char *name, const char *corpus, const char *unit, double *samples, int count,
+                   const char *extra) {
+	qsort(samples, count, sizeof(*samples), compare_doubles);
+	double sum = 0;
+	for (int i = 0; i < count; i++) {
+		sum += samples[i];
+	}
+	printf("{\"bench\":\"%s\",\"corpus\":\"%s\",\"unit\":\"%s\",\"samples\":%d,"
+	       "\"mean\":%.2f,\"min\":%.2f,\"p50\":%.2f,\"p90\":%.2f,\"p99\":%.2f,\"max\":%.2f%s%s}\n",
+	       name, corpus, unit, count, sum / count, samples[0], samples[count / 2],
+	       samples[count * 90 / 100], samples[count * 99 / 100], samples[count - 1],
+	       extra ? "," : "", extra ? extra : "");
+	fflush(stdout);
+}
+
+/**
+ * Fills the column with occupied tiles from the bottom up to the given height.
+ * @param game
+ * @param x
+ * @param height
+ */
+static void fill_column(tt_tetris *game, int x, int height) {
+	for (int y = game->rows - height; y < game->rows; y++) {
+		game->board[y][x] = 1 + x % 7;
+	}
+}
+
+/**
+ * Starts a new corpus with an empty board of the given size.
+ * @param name
+ * @param rows
+ * @param cols
+ * @return
+ */
+static corpus *add_corpus(const char *name, int rows, int cols) {
+	corpus *c = &corpora[corpus_count++];
+	memset(c, 0, sizeof(*c));
+	if (cols == BOARD_X && rows == BOARD_Y) {
+		snprintf(c->name, sizeof(c->name), "%s", name);
+	} else {
+		snprintf(c->name, sizeof(c->name), "%s-%dx%d", name, cols, rows);
+	}
+	bd_resize(&c->game, rows, cols);
+	return c;
+}
+
+/**
+ * Builds the curated boards of the given size: empty, a flat stack with one hole per row,
+ * a jagged surface, a jagged surface with holes and a stack with four full rows at the bottom.
+ * @param rng
+ * @param rows
+ * @param cols
+ */
+static void build_corpora(uint32_t *rng, int rows, int cols) {
+	corpus *first = add_corpus("empty", rows, cols);
+
+	corpus *c = add_corpus("flat", rows, cols);
+	for (int y = rows - 8; y < rows; y++) {
+		for (int x = 0; x < cols; x++) {
+			c->game.board[y][x] = x == y % cols ? 0 : GARBAGE_BLOCK;
+		}
+	}
+
+	corpus *jagged = c = add_corpus("jagged", rows, cols);
+	for (int x = 0; x < cols; x++) {
+		fill_column(&c->game, x, gm_xorshift(rng) % 13);
+	}
+
+	c = add_corpus("holes", rows, cols);
+	memcpy(c->game.board, jagged->game.board, sizeof(c->game.board));
+	for (int i = 0; i < cols * 2; i++) {
+		c->game.board[rows - 1 - gm_xorshift(rng) % 10][gm_xorshift(rng) % cols] = 0;
+	}
+
+	c = add_corpus("clears", rows, cols);
+	memcpy(c->game.board, jagged->game.board, sizeof(c->game.board));
+	for (int y = rows - 4; y < rows; y++) {
+		for (int x = 0; x < cols; x++) {
+			c->game.board[y][x] = GARBAGE_BLOCK;
+		}
+	}
+
+	for (c = first; c <= &corpora[corpus_count - 1]; c++) {
+		bd_sync(&c->game);
+	}
+}
+
+/**
+ * Collects collision queries for every block, rotation and column at a few heights.
+ * @param queries array with room for 7 * 4 * (BOARD_MAX_X + 4) * 4 queries.
+ * @param rows
+ * @param cols
+ * @return the number of queries.
+ */
+static int build_queries(query *queries, int rows, int cols) {
+	int count = 0;
+	for (int type = 0; type < 7; type++) {
+		tetris_block block = gm_block(type);
+		for (int rotation = 0; rotation < 4; rotation++) {
+			for (int x = -2; x < cols + 2; x++) {
+				for (int y = 0; y < rows; y += rows / 4) {
+					queries[count++] = (query){ block, x, y };
+				}
+			}
+			block = rotate_block(block);
+		}
+	}
+	return count;
+}
+
+static void bench_would_collide(corpus *c) {
+	static query queries[7 * 4 * (BOARD_MAX_X + 4) * 4];
+	int count = build_queries(queries, c->game.rows, c->game.cols);
+	double samples[SAMPLES];
+	int next = 0;
+	for (int s = 0; s < SAMPLES; s++) {
+		long hits = 0;
+		long long start = now_ns();
+		for (int i = 0; i < BATCH; i++) {
+			query *q = &queries[next];
+			hits += would_collide(&c->game, q->block, q->x_move, q->y_move);
+			next = next + 1 == count ? 0 : next + 1;
+		}
+		samples[s] = (double)(now_ns() - start) / BATCH;
+		sink += hits;
+	}
+	report("would_collide", c->name, "ns/op", samples, SAMPLES, NULL);
+}
+
+static void bench_rotate_block() {
+	tetris_block blocks[7];
+	for (int type = 0; type < 7; type++) {
+		blocks[type] = gm_block(type);
+	}
+	double samples[SAMPLES];
+	for (int s = 0; s < SAMPLES; s++) {
+		long long start = now_ns();
+		for (int i = 0; i < BATCH; i++) {
+			blocks[i % 7] = rotate_block(blocks[i % 7]);
+		}
+		samples[s] = (double)(now_ns() - start) / BATCH;
+		sink += blocks[s % 7].array[0][0];
+	}
+	report("rotate_block", "-", "ns/op", samples, SAMPLES, NULL);
+}
+
+/**
+ * Prepares a game on the given board with the block of the given type floating above the surface.
+ * @param tetris
+ * @param c
+ * @param type
+ */
+static void setup_game(tt_tetris *tetris, corpus *c, int type) {
+	*tetris = c->game;
+	gm_seed_game(tetris, SEED);
+	memcpy(tetris->board, c->game.board, sizeof(tetris->board));
+	bd_sync(tetris);
+	tetris->current_block = gm_block(type);
+	tetris->current_block.x = (tetris->cols - tetris->current_block.width) / 2;
+	tetris->current_block.y = 0;
+}
+
+static void bench_try_rotation(corpus *c) {
+	tt_tetris games[7];
+	for (int type = 0; type < 7; type++) {
+		setup_game(&games[type], c, type);
+	}
+	double samples[SAMPLES];
+	for (int s = 0; s < SAMPLES; s++) {
+		long long start = now_ns();
+		for (int i = 0; i < BATCH; i++) {
+			gm_move_block(&games[i % 7], TT_ROTATE);
+		}
+		samples[s] = (double)(now_ns() - start) / BATCH;
+		sink += games[s % 7].current_block.x;
+	}
+	report("try_rotation", c->name, "ns/op", samples, SAMPLES, NULL);
+}
+
+/**
+ * Times delete_lines with the current block covering the bottom four rows. The board and its row
+ * words are restored before every call, the cost of the copy is reported separately as board_copy.
+ * @param c
+ */
+static void bench_delete_lines(corpus *c) {
+	tt_tetris tetris;
+	setup_game(&tetris, c, 4);
+	tetris.current_block.y = tetris.rows - 4;
+	size_t size = sizeof(tetris.board[0]) * tetris.rows;
+	double samples[SAMPLES], copies[SAMPLES];
+	for (int s = 0; s < SAMPLES; s++) {
+		long long start = now_ns();
+		for (int i = 0; i < BATCH; i++) {
+			memcpy(tetris.board, c->game.board, size);
+			tetris.row_bits = c->game.row_bits;
+			delete_lines(&tetris);
+		}
+		samples[s] = (double)(now_ns() - start) / BATCH;
+		start = now_ns();
+		for (int i = 0; i < BATCH; i++) {
+			memcpy(tetris.board, c->game.board, size);
+			tetris.row_bits = c->game.row_bits;
+			sink += tetris.board[s % tetris.rows][i % tetris.cols];
+		}
+		copies[s] = (double)(now_ns() - start) / BATCH;
+	}
+	report("delete_lines", c->name, "ns/op", samples, SAMPLES, NULL);
+	report("board_copy", c->name, "ns/op", copies, SAMPLES, NULL);
+}
+
+/**
+ * Times a hard drop of every block type, including locking, line clears and the next spawn.
+ * The whole game is restored before every drop.
+ * @param c
+ */
+static void bench_hard_drop(corpus *c) {
+	tt_tetris games[7], tetris;
+	for (int type = 0; type < 7; type++) {
+		setup_game(&games[type], c, type);
+	}
+	double samples[SAMPLES];
+	for (int s = 0; s < SAMPLES; s++) {
+		long long start = now_ns();
+		for (int i = 0; i < BATCH; i++) {
+			tetris = games[i % 7];
+			gm_move_block(&tetris, TT_FALL_DOWN);
+		}
+		samples[s] = (double)(now_ns() - start) / BATCH;
+		sink += tetris.score;
+	}
+	report("hard_drop", c->name, "ns/op", samples, SAMPLES, NULL);
+}
+
+/** Number of pieces timed together in one sample of the landing row benchmarks. */
+#define PIECES 32
+
+/**
+ * Finds the landing row of every rotation and column of a block by dropping it from the top row
+ * by row, as the game does.
+ * @param tetris
+ * @param rotated the four rotations of the block.
+ * @return the sum of the landing rows found.
+ */
+static long drop_all(const tt_tetris *tetris, const tetris_block *rotated) {
+	long sum = 0;
+	for (int r = 0; r < 4; r++) {
+		tetris_block block = rotated[r];
+		for (block.x = -3; block.x < tetris->cols; block.x++) {
+			if (!would_collide(tetris, block, 0, 0)) sum += bd_drop_distance(tetris, &block, tetris->rows);
+		}
+	}
+	return sum;
+}
+
+/**
+ * Times finding the landing rows of all rotations and columns of a piece: dropping every one of
+ * them row by row, and computing them all at once from the surface with the scalar and the SIMD
+ * kernel. Checks that both kernels agree with each other on every column and with the drop
+ * wherever the block fits the top rows.
+ * @param c
+ */
+static void bench_landing_rows(corpus *c) {
+	tt_tetris games[7];
+	tetris_block rotated[7][4];
+	bd_profile profiles[7][4];
+	int8_t tops[BD_SURFACE], rows[4][BD_LANES], reference[4][BD_LANES];
+	unsigned long long checked = 0, mismatches = 0;
+	for (int type = 0; type < 7; type++) {
+		setup_game(&games[type], c, type);
+		rotated[type][0] = games[type].current_block;
+		rotated[type][0].x = 0;
+		for (int r = 0; r < 4; r++) {
+			if (r) rotated[type][r] = rotate_block(rotated[type][r - 1]);
+			bd_block_profile(&rotated[type][r], &profiles[type][r]);
+		}
+		bd_surface(&games[type], tops);
+		bd_landing_rows(tops, profiles[type], 4, c->game.cols, rows);
+		bd_landing_rows_scalar(tops, profiles[type], 4, c->game.cols, reference);
+		for (int r = 0; r < 4; r++) {
+			const bd_profile *profile = &profiles[type][r];
+			for (int x = 0; x + profile->count <= c->game.cols; x++) {
+				tetris_block block = rotated[type][r];
+				block.x = x - profile->first;
+				bool fits = !would_collide(&games[type], block, 0, 0) && rows[r][x] >= 0;
+				++checked;
+				if (rows[r][x] != reference[r][x] ||
+				    (fits && rows[r][x] != bd_drop_distance(&games[type], &block, c->game.rows))) {
+					++mismatches;
+				}
+			}
+		}
+	}
+
+	static const char *names[3] = { "landing_drop", "landing_scalar", "landing_simd" };
+	double samples[3][SAMPLES], means[3];
+	for (int k = 0; k < 3; k++) {
+		means[k] = 0;
+		for (int s = 0; s < SAMPLES; s++) {
+			long long start = now_ns();
+			for (int i = 0; i < PIECES; i++) {
+				int type = i % 7;
+				if (k == 0) {
+					sink += drop_all(&games[type], rotated[type]);
+					continue;
+				}
+				bd_surface(&games[type], tops);
+				if (k == 1) bd_landing_rows_scalar(tops, profiles[type], 4, c->game.cols, rows);
+				else bd_landing_rows(tops, profiles[type], 4, c->game.cols, rows);
+				sink += rows[i % 4][0];
+			}
+			samples[k][s] = (double)(now_ns() - start) / PIECES;
+			means[k] += samples[k][s] / SAMPLES;
+		}
+	}
+	char extra[160];
+	report(names[0], c->name, "ns/piece", samples[0], SAMPLES, NULL);
+	snprintf(extra, sizeof(extra), "\"speedup\":%.1f", means[0] / means[1]);
+	report(names[1], c->name, "ns/piece", samples[1], SAMPLES, extra);
+	snprintf(extra, sizeof(extra), "\"kernel\":\"%s\",\"speedup\":%.1f,\"checked\":%llu,\"mismatches\":%llu",
+	         bd_landing_kernel(), means[0] / means[2], checked, mismatches);
+	report(names[2], c->name, "ns/piece", samples[2], SAMPLES, extra);
+}
+
+/**
+ * Times a gravity tick of every block type at the first level and at 20G, where the block falls
+ * all the way to the stack within the tick, still with a single drop distance query.
+ * The whole game is restored before every tick.
+ * @param c
+ */
+static void bench_gravity_tick(corpus *c) {
+	static const unsigned levels[2] = { 0, 19 };
+	static const char *names[2] = { "tick_level0", "tick_20g" };
+	tt_tetris games[7], tetris;
+	for (int l = 0; l < 2; l++) {
+		for (int type = 0; type < 7; type++) {
+			setup_game(&games[type], c, type);
+			games[type].level = levels[l];
+		}
+		double samples[SAMPLES];
+		for (int s = 0; s < SAMPLES; s++) {
+			long long start = now_ns();
+			for (int i = 0; i < BATCH; i++) {
+				tetris = games[i % 7];
+				gm_move_block(&tetris, TT_TICK);
+			}
+			samples[s] = (double)(now_ns() - start) / BATCH;
+			sink += tetris.current_block.y;
+		}
+		report(names[l], c->name, "ns/op", samples, SAMPLES, NULL);
+	}
+}
+
+/**
+ * Feeds a game with random inputs: mostly sideways moves and rotations, every few inputs a drop.
+ * @param tetris
+ */
+static void random_input(tt_tetris *tetris) {
+	static const enum tt_movement moves[8] = {
+		TT_LEFT, TT_RIGHT, TT_ROTATE, TT_LEFT, TT_RIGHT, TT_DOWN, TT_DOWN, TT_FALL_DOWN
+	};
+	gm_move_block(tetris, moves[gm_random(tetris) % 8]);
+}
+
+/**
+ * Plays whole games with random inputs and reports the time spent per placed block.
+ */
+static void bench_game_throughput() {
+	tt_tetris tetris;
+	memset(&tetris, 0, sizeof(tetris));
+	bd_resize(&tetris, BOARD_Y, BOARD_X);
+	double samples[GAMES];
+	unsigned long long pieces = 0;
+	long long total = 0;
+	for (int g = 0; g < GAMES; g++) {
+		gm_seed_game(&tetris, SEED + g);
+		long long start = now_ns();
+		while (!gm_is_game_over(&tetris)) {
+			random_input(&tetris);
+		}
+		long long elapsed = now_ns() - start;
+		samples[g] = (double)elapsed / tetris.block_count;
+		pieces += tetris.block_count;
+		total += elapsed;
+	}
+	char extra[64];
+	snprintf(extra, sizeof(extra), "\"pieces_per_sec\":%.0f", pieces * 1e9 / total);
+	report("game_throughput", "random", "ns/piece", samples, GAMES, extra);
+}
+
+/**
+ * Lets the search bot play a game on the default and on the largest board with a fixed budget
+ * per piece, and reports the time every move took. How far the moves looked ahead shows how much
+ * of the search fit into the budget, the workers left out for handing in late and the moves
+ * missed, dropped as they were, how often it did not.
+ * @param threads number of search workers.
+ * @return false if the search pool could not be started.
+ */
+static bool bench_bot_search(int threads) {
+	static const int boards[2][2] = { { BOARD_Y, BOARD_X }, { BOARD_MAX_Y, BOARD_MAX_X } };
+	bt_searcher searcher;
+	if (!bt_init_searcher(&searcher, threads)) {
+		bt_destroy_searcher(&searcher);
+		return false;
+	}
+	tt_tetris tetris;
+	for (int b = 0; b < 2; b++) {
+		memset(&tetris, 0, sizeof(tetris));
+		bd_resize(&tetris, boards[b][0], boards[b][1]);
+		gm_seed_game(&tetris, SEED);
+		double samples[SAMPLES];
+		int moves = 0, deep = 0, late = 0, missed = 0;
+		unsigned long long placements = 0;
+		while (moves < SAMPLES && !gm_is_game_over(&tetris)) {
+			long long start = now_ns();
+			bt_move move;
+			bool found = bt_search_move(&searcher, &tetris, &bt_default_weights, BOT_BUDGET_US, &move);
+			samples[moves++] = (now_ns() - start) / 1000.0;
+			deep += searcher.depth == 2;
+			late += searcher.late;
+			missed += !found;
+			placements += searcher.placements;
+			if (found) bt_apply_move(&tetris, move);
+			else gm_move_block(&tetris, TT_FALL_DOWN);
+		}
+		char name[32], extra[192];
+		snprintf(name, sizeof(name), "%dx%d", tetris.cols, tetris.rows);
+		snprintf(extra, sizeof(extra), "\"budget_us\":%d,\"threads\":%d,\"look_ahead_share\":%.2f,"
+		         "\"placements_per_move\":%.0f,\"late_workers\":%d,\"missed\":%d,\"lines\":%u", BOT_BUDGET_US,
+		         searcher.threads, (double)deep / moves, (double)placements / moves, late, missed, tetris.lines);
+		report("bt_search_move", name, "us/move", samples, moves, extra);
+	}
+	bt_destroy_searcher(&searcher);
+	return true;
+}
+
+/**
+ * Fills a placement cache with the decisions of the greedy bot in a few games, writes and maps it
+ * like the game does, then times the lookups for every block of another game played the same way
+ * and reports how many of them hit.
+ * @return false if the cache file could not be written or mapped.
+ */
+static bool bench_placement_cache() {
+	static pc_entry entries[4 * 500];
+	char path[] = "/tmp/ttbench-cache-XXXXXX";
+	int fd = mkstemp(path);
+	if (fd < 0) {
+		return false;
+	}
+	close(fd);
+	tt_tetris tetris;
+	memset(&tetris, 0, sizeof(tetris));
+	bd_resize(&tetris, BOARD_Y, BOARD_X);
+	uint32_t count = 0;
+	for (int g = 0; g < 4; g++) {
+		gm_seed_game(&tetris, SEED + g);
+		while (!gm_is_game_over(&tetris) && tetris.block_count < 500) {
+			bt_move move = bt_best_move(&tetris, &bt_default_weights);
+			entries[count++] = (pc_entry){ pc_key(&tetris), (uint8_t)move.rotations, (uint8_t)move.shift, { 0 } };
+			bt_apply_move(&tetris, move);
+		}
+	}
+	pc_cache cache;
+	bool opened = pc_write(path, entries, count) && pc_open(&cache, path);
+	unlink(path);
+	if (!opened) {
+		return false;
+	}
+
+	double samples[SAMPLES];
+	bt_move move;
+	gm_seed_game(&tetris, SEED + 4);
+	for (int s = 0; s < SAMPLES; s++) {
+		if (gm_is_game_over(&tetris)) {
+			gm_seed_game(&tetris, SEED + 4 + s);
+		}
+		long long start = now_ns();
+		for (int i = 0; i < BATCH; i++) {
+			sink += pc_lookup(&cache, &tetris, &move);
+		}
+		samples[s] = (double)(now_ns() - start) / BATCH;
+		bt_apply_move(&tetris, bt_best_move(&tetris, &bt_default_weights));
+	}
+	char extra[96];
+	snprintf(extra, sizeof(extra), "\"positions\":%u,\"hit_rate\":%.3f", cache.file->count,
+	         (double)cache.hits / (cache.hits + cache.misses));
+	report("pc_lookup", "greedy", "ns/op", samples, SAMPLES, extra);
+	pc_close(&cache);
+	return true;
+}
+
+/**
+ * Records games of the greedy bot into an archive, every block steered and then left to gravity
+ * at the first level like a player would, and times replaying the whole archive per piece.
+ * @return false if the archive could not be written or mapped.
+ */
+static bool bench_replay() {
+	char path[] = "/tmp/ttbench-archive-XXXXXX";
+	int fd = mkstemp(path);
+	if (fd < 0) {
+		return false;
+	}
+	close(fd);
+	unlink(path);
+	rp_recorder recorder;
+	if (!rp_open(&recorder, path)) {
+		return false;
+	}
+	tt_tetris tetris;
+	memset(&tetris, 0, sizeof(tetris));
+	bd_resize(&tetris, BOARD_Y, BOARD_X);
+	for (int g = 0; g < 4; g++) {
+		rp_finish(&recorder, &tetris);
+		gm_seed_game(&tetris, SEED + g);
+		rp_start(&recorder, &tetris, SEED + g);
+		while (!gm_is_game_over(&tetris) && tetris.block_count < 250) {
+			bt_move move = bt_best_move(&tetris, &bt_default_weights);
+			for (int i = 0; i < move.rotations; i++) {
+				gm_move_block(&tetris, TT_ROTATE);
+				rp_move(&recorder, TT_ROTATE);
+			}
+			while (!would_collide(&tetris, tetris.current_block, -1, 0)) {
+				gm_move_block(&tetris, TT_LEFT);
+				rp_move(&recorder, TT_LEFT);
+			}
+			for (int i = 0; i < move.shift; i++) {
+				gm_move_block(&tetris, TT_RIGHT);
+				rp_move(&recorder, TT_RIGHT);
+			}
+			for (unsigned pieces = tetris.block_count; tetris.block_count == pieces;) {
+				gm_move_block(&tetris, TT_TICK);
+				rp_move(&recorder, TT_TICK);
+			}
+		}
+	}
+	rp_close(&recorder, &tetris);
+	rp_archive archive;
+	bool mapped = rp_map(&archive, path);
+	unlink(path);
+	if (!mapped) {
+		return false;
+	}
+
+	double samples[SAMPLES];
+	rp_stats stats;
+	for (int s = 0; s < SAMPLES; s++) {
+		memset(&stats, 0, sizeof(stats));
+		size_t offset = sizeof(rp_header);
+		const rp_game *game;
+		long long start = now_ns();
+		while ((game = rp_next(&archive, &offset))) {
+			rp_replay(&tetris, game, &stats);
+		}
+		samples[s] = (double)(now_ns() - start) / stats.pieces;
+	}
+	char extra[128];
+	snprintf(extra, sizeof(extra), "\"pieces\":%llu,\"ticks_per_piece\":%.1f,\"bytes_per_piece\":%.1f,\"mismatches\":%llu",
+	         stats.pieces, (double)stats.moves / stats.pieces, (double)archive.size / stats.pieces, stats.mismatches);
+	report("rp_replay", "gravity", "ns/piece", samples, SAMPLES, extra);
+	rp_unmap(&archive);
+	return true;
+}
+
+/**
+ * Records a game with randomly dropped blocks on the largest board into a history, then times stepping back
+ * from its last piece by distances spread over the whole game. Also reports the memory a history
+ * of RW_PIECES pieces takes on the largest and on the default board.
+ * @return false if a history could not be allocated.
+ */
+static bool bench_rewind() {
+	tt_tetris tetris, game;
+	rw_history history, probe;
+	if (!rw_init(&history, RW_PIECES, BOARD_Y, BOARD_X)) {
+		rw_destroy(&history);
+		return false;
+	}
+	size_t small = rw_memory(&history);
+	rw_destroy(&history);
+	if (!rw_init(&history, RW_PIECES, BOARD_MAX_Y, BOARD_MAX_X)) {
+		rw_destroy(&history);
+		return false;
+	}
+	memset(&tetris, 0, sizeof(tetris));
+	bd_resize(&tetris, BOARD_MAX_Y, BOARD_MAX_X);
+	gm_seed_game(&tetris, SEED);
+	rw_restart(&history, &tetris);
+	// blocks are dropped into random columns, so the board takes many pieces to fill up
+	while (!gm_is_game_over(&tetris)) {
+		int rotations = gm_random(&tetris) % 4, shift = gm_random(&tetris) % tetris.cols - tetris.cols / 2;
+		for (int i = 0; i < rotations; i++) {
+			gm_move_block(&tetris, TT_ROTATE);
+		}
+		for (int i = 0; i < abs(shift); i++) {
+			gm_move_block(&tetris, shift < 0 ? TT_LEFT : TT_RIGHT);
+		}
+		gm_move_block(&tetris, TT_FALL_DOWN);
+		rw_record(&history, &tetris);
+	}
+
+	unsigned pieces = history.newest - history.oldest;
+	double samples[SAMPLES];
+	for (int s = 0; s < SAMPLES; s++) {
+		long long start = now_ns();
+		for (int i = 0; i < BATCH; i++) {
+			probe = history;
+			game = tetris;
+			rw_step_back(&probe, &game, 1 + (s * BATCH + i) % pieces);
+		}
+		samples[s] = (double)(now_ns() - start) / BATCH;
+		sink += game.score;
+	}
+	char extra[128];
+	snprintf(extra, sizeof(extra), "\"pieces\":%u,\"bytes_%u_pieces\":%zu,\"bytes_%u_pieces_%dx%d\":%zu",
+	         pieces, RW_PIECES, rw_memory(&history), RW_PIECES, BOARD_X, BOARD_Y, small);
+	report("rw_step_back", "random", "ns/op", samples, SAMPLES, extra);
+	rw_destroy(&history);
+	return true;
+}
+
+/**
+ * Renders a game with random inputs into an in-memory framebuffer, which measures composing the
+ * game window without any terminal involved.
+ * @return false if the framebuffer could not be allocated.
+ */
+static bool bench_render_framebuffer() {
+	rd_framebuffer framebuffer;
+	if (!rd_init_framebuffer(&framebuffer, MAIN_WIN_Y + 2, MAIN_WIN_X + 2)) {
+		return false;
+	}
+	tt_tetris tetris;
+	memset(&tetris, 0, sizeof(tetris));
+	bd_resize(&tetris, BOARD_Y, BOARD_X);
+	gm_seed_game(&tetris, SEED);
+
+	static double samples[FRAMES];
+	long long total = 0;
+	for (int f = 0; f < FRAMES; f++) {
+		random_input(&tetris);
+		if (gm_is_game_over(&tetris)) {
+			gm_reset_game(&tetris);
+		}
+		long long start = now_ns();
+		dw_render_game(&framebuffer.base, &tetris);
+		long long elapsed = now_ns() - start;
+		samples[f] = elapsed / 1000.0;
+		total += elapsed;
+	}
+	char extra[64];
+	snprintf(extra, sizeof(extra), "\"frames_per_sec\":%.0f", FRAMES * 1e9 / total);
+	report("dw_render_game", "framebuffer", "us/frame", samples, FRAMES, extra);
+	rd_destroy_framebuffer(&framebuffer);
+	return true;
+}
+
+/**
+ * Renders a game with random inputs into a curses screen that writes to /dev/null.
+ * @return false if the headless terminal could not be created.
+ */
+static bool bench_draw_game_window() {
+	FILE *out = fopen("/dev/null", "w");
+	FILE *in = fopen("/dev/null", "r");
+	if (!out || !in) {
+		return false;
+	}
+	// the game window needs more room than the 80x24 a terminal description defaults to
+	setenv("LINES", "40", 1);
+	setenv("COLUMNS", "100", 1);
+	SCREEN *screen = newterm("xterm", out, in);
+	if (!screen) {
+		fclose(out);
+		fclose(in);
+		return false;
+	}
+	if (has_colors()) enable_color();
+
+	tt_tetris tetris;
+	memset(&tetris, 0, sizeof(tetris));
+	bd_resize(&tetris, BOARD_Y, BOARD_X);
+	gm_seed_game(&tetris, SEED);
+	if (!dw_init_windows(&tetris)) {
+		endwin();
+		delscreen(screen);
+		fclose(out);
+		fclose(in);
+		return false;
+	}
+
+	static double samples[FRAMES];
+	long long total = 0;
+	for (int f = 0; f < FRAMES; f++) {
+		random_input(&tetris);
+		if (gm_is_game_over(&tetris)) {
+			gm_reset_game(&tetris);
+		}
+		long long start = now_ns();
+		dw_draw_game_window(&tetris);
+		long long elapsed = now_ns() - start;
+		samples[f] = elapsed / 1000.0;
+		total += elapsed;
+	}
+	char extra[64];
+	snprintf(extra, sizeof(extra), "\"frames_per_sec\":%.0f", FRAMES * 1e9 / total);
+	report("dw_draw_game_window", "random", "us/frame", samples, FRAMES, extra);
+
+	dw_delete_windows(&tetris);
+	delscreen(screen);
+	fclose(out);
+	fclose(in);
+	return true;
+}
+
+/**
+ * Runs all micro and macro benchmarks and prints one JSON line per benchmark.
+ */
+int main(void) {
+	uint32_t rng = SEED;
+	for (int i = 0; i < 3; i++) {
+		build_corpora(&rng, sizes[i][0], sizes[i][1]);
+	}
+
+	bench_rotate_block();
+	for (int i = 0; i < corpus_count; i++) {
+		bench_would_collide(&corpora[i]);
+		bench_try_rotation(&corpora[i]);
+		bench_delete_lines(&corpora[i]);
+		bench_hard_drop(&corpora[i]);
+		bench_gravity_tick(&corpora[i]);
+		bench_landing_rows(&corpora[i]);
+	}
+	bench_game_throughput();
+	if (!bench_bot_search((int)sysconf(_SC_NPROCESSORS_ONLN))) {
+		fprintf(stderr, "Couldn't start search threads, skipping bot benchmark!\n");
+	}
+	if (!bench_placement_cache()) {
+		fprintf(stderr, "Couldn't write placement cache, skipping cache benchmark!\n");
+	}
+	if (!bench_replay()) {
+		fprintf(stderr, "Couldn't write game archive, skipping replay benchmark!\n");
+	}
+	if (!bench_rewind()) {
+		fprintf(stderr, "Couldn't allocate rewind history, skipping rewind benchmark!\n");
+	}
+	bench_render_framebuffer();
+	if (!bench_draw_game_window()) {
+		fprintf(stderr, "Couldn't create headless terminal, skipping render benchmark!\n");
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,78 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "tt_bot.h"
+#include "tt_cache.h"
+#include "tt_game.h"
+#include "tt_tetris.h"
+
+/** Seed of the first game, game g is played with SEED + g. */
+#define SEED 20240601u
+
+/** Time the search may take per block. Offline it is meant to finish the whole look ahead. */
+#define BUDGET_US 1000000
+
+/**
+ * Fills a placement cache by self-play: the bot plays seeded games with the full search and every
+ * decision it takes is written to the cache file, keyed by the contour of the board and the two
+ * blocks known. The game maps the file with "./main --bot --cache PATH".
+ */
+int main(int argc, char *argv[]) {
+	const char *path = "ttcache.bin";
+	int games = 20, threads = (int)sysconf(_SC_NPROCESSORS_ONLN), rows = BOARD_Y, cols = BOARD_X;
+	unsigned pieces = 1000;
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (!strcmp(argv[i], "--out")) path = argv[i + 1];
+		else if (!strcmp(argv[i], "--games")) games = atoi(argv[i + 1]);
+		else if (!strcmp(argv[i], "--pieces")) pieces = (unsigned)atoi(argv[i + 1]);
+		else if (!strcmp(argv[i], "--threads")) threads = atoi(argv[i + 1]);
+		else if (!strcmp(argv[i], "--board") && sscanf(argv[i + 1], "%dx%d", &cols, &rows) == 2) continue;
+		else break;
+	}
+	tt_tetris *tetris = calloc(1, sizeof(*tetris));
+	pc_entry *entries = calloc((size_t)games * pieces + 1, sizeof(pc_entry));
+	if (games < 1 || threads < 1 || !tetris || !entries || !bd_resize(tetris, rows, cols)) {
+		fprintf(stderr, "Usage: %s [--out PATH] [--games N] [--pieces N] [--threads N] [--board COLSxROWS]\n", argv[0]);
+		free(tetris);
+		free(entries);
+		return EXIT_FAILURE;
+	}
+	bt_searcher searcher;
+	if (!bt_init_searcher(&searcher, threads)) {
+		fprintf(stderr, "Couldn't start any search thread!\n");
+		bt_destroy_searcher(&searcher);
+		free(tetris);
+		free(entries);
+		return EXIT_FAILURE;
+	}
+
+	uint32_t count = 0;
+	for (int g = 0; g < games; g++) {
+		gm_seed_game(tetris, SEED + g);
+		while (!gm_is_game_over(tetris) && tetris->block_count < pieces) {
+			bt_move move;
+			if (!bt_search_move(&searcher, tetris, &bt_default_weights, BUDGET_US, &move)) {
+				gm_move_block(tetris, TT_FALL_DOWN);
+				continue;
+			}
+			entries[count++] = (pc_entry){ pc_key(tetris), (uint8_t)move.rotations, (uint8_t)move.shift, { 0 } };
+			bt_apply_move(tetris, move);
+		}
+		printf("game %d: %u pieces, %u lines\n", g, tetris->block_count, tetris->lines);
+		fflush(stdout);
+	}
+	bt_destroy_searcher(&searcher);
+
+	uint32_t kept = pc_write(path, entries, count);
+	free(tetris);
+	free(entries);
+	if (!kept) {
+		fprintf(stderr, "Couldn't write placement cache to %s!\n", path);
+		return EXIT_FAILURE;
+	}
+	printf("%u decisions, %u positions written to %s\n", count, kept, path);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,55 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "tt_board.h"
+#include "tt_bot.h"
+#include "tt_draw.h"
+#include "tt_game.h"
+#include "tt_render.h"
+#include "tt_tetris.h"
+
+/** Fixed seed, so every run renders exactly the same game. */
+#define SEED 20240601u
+
+/** Pieces the greedy bot places before the frames are taken. */
+#define PIECES 40
+
+/**
+ * Renders the game window once into a framebuffer and writes it as plain text.
+ * @param tetris
+ * @param half_blocks whether the board packs two rows into every cell.
+ * @return false if the framebuffer could not be allocated.
+ */
+static bool dump_frame(tt_tetris *tetris, bool half_blocks) {
+	int size_y, size_x;
+	dw_game_size(tetris->rows, tetris->cols, &size_y, &size_x);
+	rd_framebuffer framebuffer;
+	if (!rd_init_framebuffer(&framebuffer, size_y + 2, size_x + 2)) {
+		return false;
+	}
+	framebuffer.base.half_blocks = half_blocks;
+	dw_render_game(&framebuffer.base, tetris);
+	printf("%dx%d%s\n", tetris->cols, tetris->rows, half_blocks ? " half blocks" : "");
+	rd_dump_framebuffer(&framebuffer, stdout);
+	rd_destroy_framebuffer(&framebuffer);
+	return true;
+}
+
+/**
+ * Writes golden frames for "make check": the greedy bot plays a seeded game on the default and on
+ * a wide board, and the game window is rendered into a framebuffer, with full cells and with half
+ * blocks. Any change to how the game window is composed shows up as a difference to ttframe.txt.
+ */
+int main(void) {
+	static const int boards[2][2] = { { BOARD_Y, BOARD_X }, { 24, 32 } };
+	tt_tetris *tetris = calloc(1, sizeof(*tetris));
+	bool rendered = tetris != NULL;
+	for (int b = 0; rendered && b < 2; b++) {
+		bd_resize(tetris, boards[b][0], boards[b][1]);
+		gm_seed_game(tetris, SEED);
+		bt_play(tetris, &bt_default_weights, PIECES);
+		rendered = dump_frame(tetris, false) && dump_frame(tetris, true);
+	}
+	free(tetris);
+	return rendered ? EXIT_SUCCESS : EXIT_FAILURE;
+}
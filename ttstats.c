@@ -0,0 +1,206 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "tt_replay.h"
+#include "tt_tetris.h"
+
+/** Number of games a worker takes at once. */
+#define CHUNK 64
+
+/**
+ * The games of all archives, shared by all workers. Chunk c holds the games from c * CHUNK on.
+ */
+typedef struct {
+	const rp_game **games;
+	size_t count, capacity;
+	size_t next_chunk;
+} corpus;
+
+/**
+ * A worker thread with the statistics of the games it replayed.
+ */
+typedef struct {
+	pthread_t thread;
+	corpus *corpus;
+	rp_stats stats;
+} worker;
+
+/**
+ * Reads the monotonic clock.
+ * @return the current time in seconds.
+ */
+static double now() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/**
+ * Replays chunks of games till none are left. Runs on every worker thread.
+ * @param arg the worker.
+ * @return NULL
+ */
+static void *work(void *arg) {
+	worker *self = arg;
+	corpus *games = self->corpus;
+	tt_tetris *tetris = calloc(1, sizeof(*tetris));
+	if (!tetris) {
+		return NULL;
+	}
+	size_t chunk;
+	while ((chunk = __atomic_fetch_add(&games->next_chunk, 1, __ATOMIC_RELAXED)) * CHUNK < games->count) {
+		size_t end = chunk * CHUNK + CHUNK < games->count ? chunk * CHUNK + CHUNK : games->count;
+		for (size_t i = chunk * CHUNK; i < end; i++) {
+			rp_replay(tetris, games->games[i], &self->stats);
+		}
+	}
+	free(tetris);
+	return NULL;
+}
+
+/**
+ * Adds the games of an archive to the corpus.
+ * @param games
+ * @param archive
+ * @param path of the archive, to report damaged games.
+ * @return false if there is no memory left.
+ */
+static bool add_games(corpus *games, const rp_archive *archive, const char *path) {
+	size_t offset = sizeof(rp_header);
+	const rp_game *game;
+	while ((game = rp_next(archive, &offset))) {
+		if (games->count == games->capacity) {
+			size_t capacity = games->capacity ? games->capacity * 2 : 1024;
+			const rp_game **grown = realloc(games->games, capacity * sizeof(*grown));
+			if (!grown) {
+				return false;
+			}
+			games->games = grown;
+			games->capacity = capacity;
+		}
+		games->games[games->count++] = game;
+	}
+	if (offset < archive->size) {
+		fprintf(stderr, "%s: ignoring %zu damaged bytes at the end\n", path, archive->size - offset);
+	}
+	return true;
+}
+
+/**
+ * Prints the statistics of all games.
+ * @param stats
+ */
+static void report(const rp_stats *stats) {
+	static const char *const clears[] = { "none", "single", "double", "triple", "tetris" };
+	static const char types[RP_TYPES] = { 'O', 'J', 'L', 'T', 'I', 'S', 'Z' };
+	double pieces = stats->pieces ? (double)stats->pieces : 1, games = stats->games ? (double)stats->games : 1;
+	unsigned long long topped_out = 0;
+	for (int i = 0; i < RP_TYPES; i++) {
+		topped_out += stats->topped_out[i];
+	}
+
+	printf("games: %llu, pieces: %llu, inputs: %llu, mismatching replays: %llu\n",
+	       stats->games, stats->pieces, stats->moves, stats->mismatches);
+	printf("per game: %.1f pieces, %.1f lines, %.1f score\n",
+	       stats->pieces / games, stats->lines / games, stats->score / games);
+	printf("holes formed: %.2f per 100 pieces\n\n", 100.0 * stats->holes / pieces);
+
+	printf("%-8s %14s %8s\n", "clear", "pieces", "share");
+	for (int i = 0; i < 5; i++) {
+		printf("%-8s %14llu %7.2f%%\n", clears[i], stats->clears[i], 100.0 * stats->clears[i] / pieces);
+	}
+
+	printf("\n%-8s %14s %12s %10s\n", "block", "placed", "topped out", "share");
+	for (int i = 0; i < RP_TYPES; i++) {
+		printf("%-8c %14llu %12llu %9.2f%%\n", types[i], stats->placed[i], stats->topped_out[i],
+		       topped_out ? 100.0 * stats->topped_out[i] / topped_out : 0.0);
+	}
+
+	printf("\n%-8s %14s %12s\n", "pieces", "games", "mean score");
+	for (int i = 0; i < RP_CURVE_POINTS && stats->curve_games[i]; i++) {
+		printf("%-8d %14llu %12.1f\n", (i + 1) * RP_CURVE_STEP, stats->curve_games[i],
+		       (double)stats->curve_score[i] / stats->curve_games[i]);
+	}
+}
+
+/**
+ * Replays all games of the corpus on the worker threads and adds up their statistics.
+ * @param games
+ * @param threads number of workers.
+ * @param total set to the statistics of all games.
+ * @return the number of workers that could be started.
+ */
+static int replay(corpus *games, int threads, rp_stats *total) {
+	memset(total, 0, sizeof(*total));
+	worker *workers = calloc(threads, sizeof(*workers));
+	int started = 0;
+	while (workers && started < threads) {
+		workers[started].corpus = games;
+		if (pthread_create(&workers[started].thread, NULL, work, &workers[started])) break;
+		++started;
+	}
+	for (int i = 0; i < started; i++) {
+		pthread_join(workers[i].thread, NULL);
+		rp_merge(total, &workers[i].stats);
+	}
+	free(workers);
+	return started;
+}
+
+/**
+ * Replays game archives recorded with "./main --record PATH" and prints statistics over all their
+ * games: how often pieces clear lines, how fast holes form, which blocks end the games and the mean
+ * score over the course of a game. The archives are mapped into memory and their games split into
+ * chunks the worker threads take one after another; every worker counts into statistics of its
+ * own, which are added up at the end.
+ */
+int main(int argc, char *argv[]) {
+	int threads = (int)sysconf(_SC_NPROCESSORS_ONLN), first = 1;
+	if (argc > 2 && !strcmp(argv[1], "--threads")) {
+		threads = atoi(argv[2]);
+		first = 3;
+	}
+	if (threads < 1 || first >= argc) {
+		fprintf(stderr, "Usage: %s [--threads N] ARCHIVE...\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	int count = argc - first, mapped = 0;
+	rp_archive *archives = calloc(count, sizeof(*archives));
+	corpus games = { NULL, 0, 0, 0 };
+	bool loaded = archives != NULL;
+	while (loaded && mapped < count) {
+		const char *path = argv[first + mapped];
+		if (!rp_map(&archives[mapped], path)) {
+			fprintf(stderr, "No game archive found at %s!\n", path);
+			loaded = false;
+		} else if (!add_games(&games, &archives[mapped++], path)) {
+			fprintf(stderr, "Out of memory!\n");
+			loaded = false;
+		}
+	}
+
+	rp_stats total;
+	double start = now();
+	int started = loaded ? replay(&games, threads, &total) : 0;
+	double elapsed = now() - start;
+	if (started) {
+		printf("%d archives replayed in %.2f s on %d threads, %.0f pieces/s\n", count, elapsed, started,
+		       elapsed > 0 ? total.pieces / elapsed : 0.0);
+		report(&total);
+	} else if (loaded) {
+		fprintf(stderr, "Couldn't start any worker thread!\n");
+	}
+
+	for (int i = 0; i < mapped; i++) {
+		rp_unmap(&archives[i]);
+	}
+	free(games.games);
+	free(archives);
+	return started ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,335 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "tt_bot.h"
+#include "tt_tetris.h"
+
+/** Seed of the first generation, every generation plays the games after those of the previous. */
+#define SEED 20240601u
+
+/** Candidates a game has to be played by before they may be cut off. */
+#define CUTOFF_GAMES 4
+
+/** Candidates whose mean falls below this part of the bar after CUTOFF_GAMES games are cut off. */
+#define CUTOFF_SHARE 0.5
+
+/** Standard deviation of the noise a mutation adds to a weight. */
+#define MUTATION 0.2
+
+/**
+ * A weight vector of the population with the lines its games cleared so far.
+ * Games and lines are counted by all workers at once.
+ */
+typedef struct {
+	bt_weights weights;
+	unsigned games;
+	unsigned lines;
+	bool cut;
+	double fitness;
+} candidate;
+
+/**
+ * The evaluation of one generation, shared by all workers. Job j plays game j / size with
+ * candidate j % size, so all candidates advance through their games side by side and the weak
+ * ones can be cut off before most of their games have been played.
+ */
+typedef struct {
+	candidate *population;
+	int size;
+	int games;
+	unsigned pieces;
+	uint32_t seed;
+	double bar; // mean of the worst survivor of the previous generation
+	unsigned next_job;
+	unsigned long long placed;
+	unsigned skipped;
+} generation;
+
+/** Random generator of the tuner, kept apart from the games. */
+static uint32_t rng;
+
+/**
+ * Reads the monotonic clock.
+ * @return the current time in seconds.
+ */
+static double now() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/**
+ * Draws a uniformly distributed number.
+ * @return a number in [0, 1).
+ */
+static double uniform() {
+	return gm_xorshift(&rng) / 4294967296.0;
+}
+
+/**
+ * Draws a normally distributed number (Box-Muller).
+ * @return a number with mean 0 and standard deviation 1.
+ */
+static double gaussian() {
+	return sqrt(-2 * log(1 - uniform())) * cos(6.283185307179586 * uniform());
+}
+
+/**
+ * Scales weights to unit length. Only the direction of the weights matters to the bot, so this
+ * keeps the mutations of the same strength throughout the run.
+ * @param weights
+ */
+static void normalize(bt_weights *weights) {
+	double length = 0;
+	for (int i = 0; i < BT_FEATURES; i++) {
+		length += weights->weights[i] * weights->weights[i];
+	}
+	length = sqrt(length);
+	for (int i = 0; length > 0 && i < BT_FEATURES; i++) {
+		weights->weights[i] /= length;
+	}
+}
+
+/**
+ * Plays the jobs of a generation till none are left. Runs on every worker thread.
+ * @param arg the generation.
+ * @return NULL
+ */
+static void *work(void *arg) {
+	generation *gen = arg;
+	tt_tetris *tetris = calloc(1, sizeof(*tetris));
+	if (!tetris || !bd_resize(tetris, BOARD_Y, BOARD_X)) {
+		free(tetris);
+		return NULL;
+	}
+	unsigned jobs = gen->size * gen->games, job;
+	while ((job = __atomic_fetch_add(&gen->next_job, 1, __ATOMIC_RELAXED)) < jobs) {
+		candidate *c = &gen->population[job % gen->size];
+		if (__atomic_load_n(&c->cut, __ATOMIC_RELAXED)) {
+			__atomic_add_fetch(&gen->skipped, 1, __ATOMIC_RELAXED);
+			continue;
+		}
+		gm_seed_game(tetris, gen->seed + job / gen->size);
+		unsigned lines = bt_play(tetris, &c->weights, gen->pieces);
+		__atomic_add_fetch(&gen->placed, tetris->block_count, __ATOMIC_RELAXED);
+		unsigned total = __atomic_add_fetch(&c->lines, lines, __ATOMIC_RELAXED);
+		unsigned games = __atomic_add_fetch(&c->games, 1, __ATOMIC_RELAXED);
+		if (games >= CUTOFF_GAMES && (double)total / games < CUTOFF_SHARE * gen->bar) {
+			__atomic_store_n(&c->cut, true, __ATOMIC_RELAXED);
+		}
+	}
+	free(tetris);
+	return NULL;
+}
+
+/**
+ * Sorts candidates by fitness, best first.
+ * @param a
+ * @param b
+ * @return
+ */
+static int compare_candidates(const void *a, const void *b) {
+	double x = ((const candidate *)a)->fitness, y = ((const candidate *)b)->fitness;
+	return (x < y) - (x > y);
+}
+
+/**
+ * Evaluates every candidate of a generation on the same seeded games, spread over the workers,
+ * and sorts the population by the mean lines cleared.
+ * @param gen
+ * @param threads number of workers.
+ * @return false if no worker could be started.
+ */
+static bool evaluate(generation *gen, int threads) {
+	for (int i = 0; i < gen->size; i++) {
+		gen->population[i].games = gen->population[i].lines = 0;
+		gen->population[i].cut = false;
+	}
+	gen->next_job = 0;
+	gen->placed = 0;
+	gen->skipped = 0;
+
+	pthread_t workers[threads];
+	int started = 0;
+	while (started < threads && !pthread_create(&workers[started], NULL, work, gen)) {
+		++started;
+	}
+	for (int i = 0; i < started; i++) {
+		pthread_join(workers[i], NULL);
+	}
+	for (int i = 0; i < gen->size; i++) {
+		candidate *c = &gen->population[i];
+		c->fitness = c->games ? (double)c->lines / c->games : 0;
+	}
+	qsort(gen->population, gen->size, sizeof(candidate), compare_candidates);
+	return started > 0;
+}
+
+/**
+ * Picks a parent among the better half of a sorted population, the better of two random ones.
+ * @param gen
+ * @return
+ */
+static const candidate *select_parent(const generation *gen) {
+	int half = (gen->size + 1) / 2;
+	int a = gm_xorshift(&rng) % half, b = gm_xorshift(&rng) % half;
+	return &gen->population[a < b ? a : b];
+}
+
+/**
+ * Replaces all but the best quarter of a sorted population by children of the better half.
+ * A child takes the mean of its parents, weighted by their fitness, and every weight is mutated
+ * with normally distributed noise.
+ * @param gen
+ */
+static void breed(generation *gen) {
+	int elite = gen->size / 4 > 0 ? gen->size / 4 : 1;
+	gen->bar = gen->population[elite - 1].fitness;
+	for (int i = elite; i < gen->size; i++) {
+		const candidate *a = select_parent(gen), *b = select_parent(gen);
+		double share = a->fitness + b->fitness > 0 ? a->fitness / (a->fitness + b->fitness) : 0.5;
+		candidate *child = &gen->population[i];
+		for (int w = 0; w < BT_FEATURES; w++) {
+			child->weights.weights[w] = share * a->weights.weights[w] + (1 - share) * b->weights.weights[w] +
+			                            MUTATION * gaussian();
+		}
+		normalize(&child->weights);
+	}
+}
+
+/**
+ * Writes the evaluated population to the checkpoint. The file is replaced at once, so an
+ * interrupted run always leaves a complete checkpoint behind.
+ * @param gen
+ * @param number of the generation evaluated last.
+ * @param path
+ * @return false if the file could not be written.
+ */
+static bool save_checkpoint(const generation *gen, int number, const char *path) {
+	char temporary[4096];
+	snprintf(temporary, sizeof(temporary), "%s.tmp", path);
+	FILE *file = fopen(temporary, "w");
+	if (!file) {
+		return false;
+	}
+	fprintf(file, "generation %d\n", number);
+	for (int i = 0; i < gen->size; i++) {
+		fprintf(file, "weights");
+		for (int w = 0; w < BT_FEATURES; w++) {
+			fprintf(file, " %.17g", gen->population[i].weights.weights[w]);
+		}
+		fprintf(file, " fitness %.17g\n", gen->population[i].fitness);
+	}
+	return !fclose(file) && !rename(temporary, path);
+}
+
+/**
+ * Reads the evaluated population of a checkpoint, best first. Candidates missing from the file
+ * keep their weights and no fitness.
+ * @param gen
+ * @param path
+ * @return the number of the generation evaluated last, -1 if there is no checkpoint.
+ */
+static int load_checkpoint(generation *gen, const char *path) {
+	FILE *file = fopen(path, "r");
+	int number;
+	if (!file || fscanf(file, "generation %d", &number) != 1) {
+		if (file) fclose(file);
+		return -1;
+	}
+	for (int i = 0; i < gen->size; i++) {
+		candidate *c = &gen->population[i];
+		int read = fscanf(file, " weights");
+		for (int w = 0; w < BT_FEATURES; w++) {
+			read += fscanf(file, "%lf", &c->weights.weights[w]);
+		}
+		if (read + fscanf(file, " fitness %lf", &c->fitness) != BT_FEATURES + 1) {
+			break;
+		}
+	}
+	fclose(file);
+	return number;
+}
+
+/**
+ * Evolves the weights of the bot with a genetic algorithm. Every candidate of a generation plays
+ * the same seeded games, in parallel on all cores; candidates far behind the survivors of the
+ * previous generation are cut off early. The population is checkpointed after every generation
+ * and a run started with an existing checkpoint resumes from it.
+ */
+int main(int argc, char *argv[]) {
+	const char *path = "tttune.txt";
+	int generations = 30, size = 24, games = 16, threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	unsigned pieces = 500;
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (!strcmp(argv[i], "--checkpoint")) path = argv[i + 1];
+		else if (!strcmp(argv[i], "--generations")) generations = atoi(argv[i + 1]);
+		else if (!strcmp(argv[i], "--population")) size = atoi(argv[i + 1]);
+		else if (!strcmp(argv[i], "--games")) games = atoi(argv[i + 1]);
+		else if (!strcmp(argv[i], "--pieces")) pieces = (unsigned)atoi(argv[i + 1]);
+		else if (!strcmp(argv[i], "--threads")) threads = atoi(argv[i + 1]);
+		else break;
+	}
+	if (size < 2 || games < 1 || threads < 1) {
+		fprintf(stderr, "Usage: %s [--checkpoint PATH] [--generations N] [--population N] [--games N] "
+		        "[--pieces N] [--threads N]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	generation gen = { .size = size, .games = games, .pieces = pieces };
+	gen.population = calloc(size, sizeof(candidate));
+	if (!gen.population) {
+		return EXIT_FAILURE;
+	}
+	// the hand tuned weights start out next to random ones
+	rng = SEED;
+	gen.population[0].weights = bt_default_weights;
+	for (int i = 0; i < size; i++) {
+		for (int w = 0; i && w < BT_FEATURES; w++) {
+			gen.population[i].weights.weights[w] = 2 * uniform() - 1;
+		}
+		normalize(&gen.population[i].weights);
+	}
+	int first = load_checkpoint(&gen, path) + 1;
+	if (first) {
+		printf("resuming after generation %d from %s\n", first - 1, path);
+		rng = SEED + first;
+		breed(&gen);
+	}
+
+	for (int number = first; number < first + generations; number++) {
+		gen.seed = SEED + (uint32_t)number * games;
+		double start = now();
+		if (!evaluate(&gen, threads)) {
+			fprintf(stderr, "Couldn't start any worker!\n");
+			free(gen.population);
+			return EXIT_FAILURE;
+		}
+		double elapsed = now() - start, mean = 0;
+		int cut = 0;
+		for (int i = 0; i < size; i++) {
+			mean += gen.population[i].fitness / size;
+			cut += gen.population[i].cut;
+		}
+		printf("generation %d best %.1f mean %.1f cut %d (%u games skipped) %.0f pieces/s %.1f s\n",
+		       number, gen.population[0].fitness, mean, cut, gen.skipped, gen.placed / elapsed, elapsed);
+		printf("weights");
+		for (int w = 0; w < BT_FEATURES; w++) {
+			printf(" %.4f", gen.population[0].weights.weights[w]);
+		}
+		printf("\n");
+		fflush(stdout);
+		if (!save_checkpoint(&gen, number, path)) {
+			fprintf(stderr, "Couldn't write checkpoint to %s!\n", path);
+		}
+		breed(&gen);
+	}
+	free(gen.population);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,71 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "tt_anim.h"
+#include "tt_stream.h"
+#include "tt_tetris.h"
+
+/**
+ * Spectator for games broadcast with "./main --broadcast PATH".
+ * Joins at the latest keyframe of the shared ring and follows the deltas till q is pressed.
+ * The windows are sized for the board of the first keyframe, so the viewer waits for one.
+ */
+int main(int argc, char *argv[]) {
+	if (argc != 2) {
+		fprintf(stderr, "Usage: %s PATH\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	st_reader reader;
+	if (!st_attach(&reader, argv[1])) {
+		fprintf(stderr, "No spectator stream found at %s!\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+	tt_tetris *probe = calloc(1, sizeof(*probe));
+	if (!probe || !bd_resize(probe, BOARD_Y, BOARD_X)) {
+		free(probe);
+		st_detach(&reader);
+		return EXIT_FAILURE;
+	}
+	while (!st_read_frame(&reader, probe)) {
+		nanosleep(&(struct timespec){ 0, 10000000 }, NULL);
+	}
+	int rows = probe->rows, cols = probe->cols;
+	free(probe);
+
+	// start over at the latest keyframe, now with windows of the right size
+	st_detach(&reader);
+	tt_tetris *tetris = st_attach(&reader, argv[1]) ? tt_init_tetris(NULL, rows, cols) : NULL;
+	if (!tetris) {
+		st_detach(&reader);
+		return EXIT_FAILURE;
+	}
+
+	an_timeline timeline;
+	tetris->animation = &timeline;
+	an_restart(&timeline, tetris);
+
+	bool has_frame = false;
+	int effects = 0;
+	while (getch() != 'q') {
+		bool changed = false;
+		while (st_read_frame(&reader, tetris)) {
+			changed = true;
+		}
+		// line clears are animated on the clock of the viewer, so it redraws while they run
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		an_advance(&timeline, tetris, now.tv_sec * 1000000LL + now.tv_nsec / 1000);
+		// and once more after the last one ended
+		if (changed || !has_frame || effects || timeline.count) {
+			dw_draw_game_window(tetris);
+			has_frame = true;
+		}
+		effects = timeline.count;
+	}
+	tt_destroy_tetris(tetris);
+	st_detach(&reader);
+	return EXIT_SUCCESS;
+}